@@ -28,9 +28,13 @@
 //------------------------------------------------------------------------------
 // Function declarations
 
-static inline FusionVector HalfGravity(const FusionAhrs *const ahrs);
+static inline void UpdateSample(FusionAhrs *const ahrs, const FusionVector gyroscope, const FusionVector accelerometer, const FusionVector magnetometer, const bool magnetometerPresent, const float deltaTime, const FusionConvention convention);
 
-static inline FusionVector HalfMagnetic(const FusionAhrs *const ahrs);
+static inline void UpdateBatch(FusionAhrs *const ahrs, const FusionVector *const gyroscope, const FusionVector *const accelerometer, const FusionVector *const magnetometer, const float *const deltaTimes, const float deltaTime, const size_t count, const FusionConvention convention);
+
+static inline FusionVector HalfGravity(const FusionAhrs *const ahrs, const FusionConvention convention);
+
+static inline FusionVector HalfMagnetic(const FusionAhrs *const ahrs, const FusionConvention convention);
 
 static inline FusionVector Feedback(const FusionVector sensor, const FusionVector reference);
 
@@ -111,6 +115,78 @@ void FusionAhrsSetSettings(FusionAhrs *const ahrs, const FusionAhrsSettings *con
  * @param deltaTime Delta time in seconds.
  */
 void FusionAhrsUpdate(FusionAhrs *const ahrs, const FusionVector gyroscope, const FusionVector accelerometer, const FusionVector magnetometer, const float deltaTime) {
+    UpdateSample(ahrs, gyroscope, accelerometer, magnetometer, true, deltaTime, ahrs->settings.convention);
+}
+
+/**
+ * @brief Updates the AHRS algorithm using a block of gyroscope,
+ * accelerometer, and (optionally) magnetometer measurements. The result is
+ * identical to calling FusionAhrsUpdate, or FusionAhrsUpdateNoMagnetometer if
+ * magnetometer is NULL, once per sample. The convention and magnetometer
+ * branches are resolved once per call instead of once per sample.
+ * @param ahrs AHRS algorithm structure.
+ * @param gyroscope Gyroscope measurements in degrees per second.
+ * @param accelerometer Accelerometer measurements in g.
+ * @param magnetometer Magnetometer measurements in arbitrary units, or NULL.
+ * @param deltaTimes Delta time of each sample in seconds, or NULL to use
+ * deltaTime for every sample.
+ * @param deltaTime Delta time in seconds used when deltaTimes is NULL.
+ * @param count Number of samples.
+ */
+void FusionAhrsUpdateBatch(FusionAhrs *const ahrs, const FusionVector *const gyroscope, const FusionVector *const accelerometer, const FusionVector *const magnetometer, const float *const deltaTimes, const float deltaTime, const size_t count) {
+    switch (ahrs->settings.convention) {
+        case FusionConventionNwu:
+            UpdateBatch(ahrs, gyroscope, accelerometer, magnetometer, deltaTimes, deltaTime, count, FusionConventionNwu);
+            break;
+        case FusionConventionEnu:
+            UpdateBatch(ahrs, gyroscope, accelerometer, magnetometer, deltaTimes, deltaTime, count, FusionConventionEnu);
+            break;
+        case FusionConventionNed:
+            UpdateBatch(ahrs, gyroscope, accelerometer, magnetometer, deltaTimes, deltaTime, count, FusionConventionNed);
+            break;
+    }
+}
+
+/**
+ * @brief Runs the update for each sample of a block. Called with a constant
+ * convention so that each copy is specialised for it.
+ * @param ahrs AHRS algorithm structure.
+ * @param gyroscope Gyroscope measurements in degrees per second.
+ * @param accelerometer Accelerometer measurements in g.
+ * @param magnetometer Magnetometer measurements in arbitrary units, or NULL.
+ * @param deltaTimes Delta time of each sample in seconds, or NULL.
+ * @param deltaTime Delta time in seconds used when deltaTimes is NULL.
+ * @param count Number of samples.
+ * @param convention Earth axes convention.
+ */
+static inline void UpdateBatch(FusionAhrs *const ahrs, const FusionVector *const gyroscope, const FusionVector *const accelerometer, const FusionVector *const magnetometer, const float *const deltaTimes, const float deltaTime, const size_t count, const FusionConvention convention) {
+    if (magnetometer != NULL) {
+        for (size_t index = 0; index < count; index++) {
+            UpdateSample(ahrs, gyroscope[index], accelerometer[index], magnetometer[index], true, deltaTimes == NULL ? deltaTime : deltaTimes[index], convention);
+        }
+        return;
+    }
+    for (size_t index = 0; index < count; index++) {
+        UpdateSample(ahrs, gyroscope[index], accelerometer[index], FUSION_VECTOR_ZERO, false, deltaTimes == NULL ? deltaTime : deltaTimes[index], convention);
+
+        // Zero heading during initialisation
+        if (ahrs->initialising) {
+            FusionAhrsSetHeading(ahrs, 0.0f);
+        }
+    }
+}
+
+/**
+ * @brief Updates the AHRS algorithm with one sample.
+ * @param ahrs AHRS algorithm structure.
+ * @param gyroscope Gyroscope measurement in degrees per second.
+ * @param accelerometer Accelerometer measurement in g.
+ * @param magnetometer Magnetometer measurement in arbitrary units.
+ * @param magnetometerPresent False if the magnetometer is known to be zero.
+ * @param deltaTime Delta time in seconds.
+ * @param convention Earth axes convention.
+ */
+static inline void UpdateSample(FusionAhrs *const ahrs, const FusionVector gyroscope, const FusionVector accelerometer, const FusionVector magnetometer, const bool magnetometerPresent, const float deltaTime, const FusionConvention convention) {
 #define Q ahrs->quaternion.element
 
     // Store accelerometer
@@ -135,7 +211,7 @@ void FusionAhrsUpdate(FusionAhrs *const ahrs, const FusionVector gyroscope, cons
     }
 
     // Calculate direction of gravity indicated by algorithm
-    const FusionVector halfGravity = HalfGravity(ahrs);
+    const FusionVector halfGravity = HalfGravity(ahrs, convention);
 
     // Calculate accelerometer feedback
     FusionVector halfAccelerometerFeedback = FUSION_VECTOR_ZERO;
@@ -171,10 +247,10 @@ void FusionAhrsUpdate(FusionAhrs *const ahrs, const FusionVector gyroscope, cons
     // Calculate magnetometer feedback
     FusionVector halfMagnetometerFeedback = FUSION_VECTOR_ZERO;
     ahrs->magnetometerIgnored = true;
-    if (FusionVectorIsZero(magnetometer) == false) {
+    if (magnetometerPresent && (FusionVectorIsZero(magnetometer) == false)) {
 
         // Calculate direction of magnetic field indicated by algorithm
-        const FusionVector halfMagnetic = HalfMagnetic(ahrs);
+        const FusionVector halfMagnetic = HalfMagnetic(ahrs, convention);
 
         // Calculate magnetometer feedback scaled by 0.5
         ahrs->halfMagnetometerFeedback = Feedback(FusionVectorNormalise(FusionVectorCrossProduct(halfGravity, magnetometer)), halfMagnetic);
@@ -219,11 +295,12 @@ void FusionAhrsUpdate(FusionAhrs *const ahrs, const FusionVector gyroscope, cons
 /**
  * @brief Returns the direction of gravity scaled by 0.5.
  * @param ahrs AHRS algorithm structure.
+ * @param convention Earth axes convention.
  * @return Direction of gravity scaled by 0.5.
  */
-static inline FusionVector HalfGravity(const FusionAhrs *const ahrs) {
+static inline FusionVector HalfGravity(const FusionAhrs *const ahrs, const FusionConvention convention) {
 #define Q ahrs->quaternion.element
-    switch (ahrs->settings.convention) {
+    switch (convention) {
         case FusionConventionNwu:
         case FusionConventionEnu: {
             const FusionVector halfGravity = {.axis = {
@@ -249,11 +326,12 @@ static inline FusionVector HalfGravity(const FusionAhrs *const ahrs) {
 /**
  * @brief Returns the direction of the magnetic field scaled by 0.5.
  * @param ahrs AHRS algorithm structure.
+ * @param convention Earth axes convention.
  * @return Direction of the magnetic field scaled by 0.5.
  */
-static inline FusionVector HalfMagnetic(const FusionAhrs *const ahrs) {
+static inline FusionVector HalfMagnetic(const FusionAhrs *const ahrs, const FusionConvention convention) {
 #define Q ahrs->quaternion.element
-    switch (ahrs->settings.convention) {
+    switch (convention) {
         case FusionConventionNwu: {
             const FusionVector halfMagnetic = {.axis = {
                     .x = Q.x * Q.y + Q.w * Q.z,
@@ -379,6 +457,36 @@ void FusionAhrsSetQuaternion(FusionAhrs *const ahrs, const FusionQuaternion quat
     ahrs->quaternion = quaternion;
 }
 
+/**
+ * @brief Returns the AHRS algorithm state needed to resume the algorithm with
+ * FusionAhrsRestoreSnapshot.
+ * @param ahrs AHRS algorithm structure.
+ * @return Snapshot.
+ */
+FusionAhrsSnapshot FusionAhrsGetSnapshot(const FusionAhrs *const ahrs) {
+    const FusionAhrsSnapshot snapshot = {
+            .quaternion = ahrs->quaternion,
+            .initialising = ahrs->initialising,
+            .rampedGain = ahrs->rampedGain,
+    };
+    return snapshot;
+}
+
+/**
+ * @brief Resets the AHRS algorithm and resumes from a snapshot returned by
+ * FusionAhrsGetSnapshot. The initialisation continues where the snapshot left
+ * it and is skipped if it had completed. Settings must be set before calling
+ * this function.
+ * @param ahrs AHRS algorithm structure.
+ * @param snapshot Snapshot.
+ */
+void FusionAhrsRestoreSnapshot(FusionAhrs *const ahrs, const FusionAhrsSnapshot *const snapshot) {
+    FusionAhrsReset(ahrs);
+    FusionAhrsSetQuaternion(ahrs, snapshot->quaternion);
+    ahrs->initialising = snapshot->initialising;
+    ahrs->rampedGain = snapshot->initialising ? snapshot->rampedGain : ahrs->settings.gain;
+}
+
 /**
  * @brief Returns the direction of gravity in the sensor coordinate frame.
  * @param ahrs AHRS algorithm structure.
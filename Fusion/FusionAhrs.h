@@ -14,6 +14,7 @@
 #include "FusionConvention.h"
 #include "FusionMath.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 //------------------------------------------------------------------------------
 // Definitions
@@ -74,6 +75,16 @@ typedef struct {
     bool magneticRecovery;
 } FusionAhrsFlags;
 
+/**
+ * @brief AHRS algorithm state needed to resume the algorithm after a restart
+ * without repeating the initialisation.
+ */
+typedef struct {
+    FusionQuaternion quaternion;
+    bool initialising;
+    float rampedGain;
+} FusionAhrsSnapshot;
+
 //------------------------------------------------------------------------------
 // Function declarations
 
@@ -85,6 +96,8 @@ void FusionAhrsSetSettings(FusionAhrs *const ahrs, const FusionAhrsSettings *con
 
 void FusionAhrsUpdate(FusionAhrs *const ahrs, const FusionVector gyroscope, const FusionVector accelerometer, const FusionVector magnetometer, const float deltaTime);
 
+void FusionAhrsUpdateBatch(FusionAhrs *const ahrs, const FusionVector *const gyroscope, const FusionVector *const accelerometer, const FusionVector *const magnetometer, const float *const deltaTimes, const float deltaTime, const size_t count);
+
 void FusionAhrsUpdateNoMagnetometer(FusionAhrs *const ahrs, const FusionVector gyroscope, const FusionVector accelerometer, const float deltaTime);
 
 void FusionAhrsUpdateExternalHeading(FusionAhrs *const ahrs, const FusionVector gyroscope, const FusionVector accelerometer, const float heading, const float deltaTime);
@@ -93,6 +106,10 @@ FusionQuaternion FusionAhrsGetQuaternion(const FusionAhrs *const ahrs);
 
 void FusionAhrsSetQuaternion(FusionAhrs *const ahrs, const FusionQuaternion quaternion);
 
+FusionAhrsSnapshot FusionAhrsGetSnapshot(const FusionAhrs *const ahrs);
+
+void FusionAhrsRestoreSnapshot(FusionAhrs *const ahrs, const FusionAhrsSnapshot *const snapshot);
+
 FusionVector FusionAhrsGetGravity(const FusionAhrs *const ahrs);
 
 FusionVector FusionAhrsGetLinearAcceleration(const FusionAhrs *const ahrs);
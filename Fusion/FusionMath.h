@@ -116,6 +116,13 @@ typedef union {
  */
 //#define FUSION_USE_NORMAL_SQRT
 
+/**
+ * @brief Include this definition or add as a preprocessor definition to use
+ * the polynomial approximations FusionFastAtan2 and FusionFastAsin instead of
+ * atan2f and asinf in FusionAtan2, FusionAsin and FusionQuaternionToEuler.
+ */
+//#define FUSION_USE_FAST_TRIG
+
 //------------------------------------------------------------------------------
 // Inline functions - Degrees and radians conversion
 
@@ -138,7 +145,79 @@ static inline float FusionRadiansToDegrees(const float radians) {
 }
 
 //------------------------------------------------------------------------------
-// Inline functions - Arc sine
+// Inline functions - Arc tangent and arc sine
+
+/**
+ * @brief Returns the arc tangent of y/x using an 11th order minimax polynomial
+ * for atan on 0 to 1. Maximum error is 2e-6 radians (1e-4 degrees). Signed
+ * zeros are not distinguished: the result for y = -0 is that for y = +0.
+ * @param y Y.
+ * @param x X.
+ * @return Arc tangent of y/x, in the range -pi to pi.
+ */
+static inline float FusionFastAtan2(const float y, const float x) {
+    const float absY = fabsf(y);
+    const float absX = fabsf(x);
+    if ((absX == 0.0f) && (absY == 0.0f)) {
+        return x < 0.0f ? (float) M_PI : 0.0f;
+    }
+    const float ratio = absY > absX ? absX / absY : absY / absX; // 0 to 1
+    const float ratioSquared = ratio * ratio;
+    float angle = ratio * (0.99997726f + ratioSquared * (-0.33262347f + ratioSquared * (0.19354346f + ratioSquared * (-0.11643287f + ratioSquared * (0.05265332f + ratioSquared * -0.01172120f)))));
+    if (absY > absX) {
+        angle = ((float) M_PI / 2.0f) - angle;
+    }
+    if (x < 0.0f) {
+        angle = (float) M_PI - angle;
+    }
+    return y < 0.0f ? -angle : angle;
+}
+
+/**
+ * @brief Returns x * P(x * x) with the 7th order minimax polynomial for asin
+ * on 0 to 0.5 used by FusionFastAsin. The first coefficient is exactly 1 so
+ * that the result is x for small x.
+ * @param x X, 0 to 0.5.
+ * @return Arc sine of x.
+ */
+static inline float FusionFastAsinKernel(const float x) {
+    const float xSquared = x * x;
+    return x + x * xSquared * (0.1666558f + xSquared * (0.0754053124f + xSquared * (0.0400349809f + xSquared * 0.0499531242f)));
+}
+
+/**
+ * @brief Returns the arc sine of the value using a minimax polynomial on 0
+ * to 0.5 and asin(x) = pi/2 - 2 * asin(sqrt((1 - x) / 2)) above that. The
+ * result is odd and exactly 0 for 0. Maximum error is 3e-7 radians (2e-5
+ * degrees). Values outside -1 to 1 are clamped.
+ * @param value Value.
+ * @return Arc sine of the value.
+ */
+static inline float FusionFastAsin(const float value) {
+    if (value <= -1.0f) {
+        return (float) M_PI / -2.0f;
+    }
+    if (value >= 1.0f) {
+        return (float) M_PI / 2.0f;
+    }
+    const float absValue = fabsf(value);
+    const float angle = absValue <= 0.5f ? FusionFastAsinKernel(absValue) : ((float) M_PI / 2.0f) - 2.0f * FusionFastAsinKernel(sqrtf(0.5f * (1.0f - absValue)));
+    return value < 0.0f ? -angle : angle;
+}
+
+/**
+ * @brief Returns the arc tangent of y/x.
+ * @param y Y.
+ * @param x X.
+ * @return Arc tangent of y/x.
+ */
+static inline float FusionAtan2(const float y, const float x) {
+#ifdef FUSION_USE_FAST_TRIG
+    return FusionFastAtan2(y, x);
+#else
+    return atan2f(y, x);
+#endif
+}
 
 /**
  * @brief Returns the arc sine of the value.
@@ -146,6 +225,9 @@ static inline float FusionRadiansToDegrees(const float radians) {
  * @return Arc sine of the value.
  */
 static inline float FusionAsin(const float value) {
+#ifdef FUSION_USE_FAST_TRIG
+    return FusionFastAsin(value);
+#else
     if (value <= -1.0f) {
         return (float) M_PI / -2.0f;
     }
@@ -153,6 +235,7 @@ static inline float FusionAsin(const float value) {
         return (float) M_PI / 2.0f;
     }
     return asinf(value);
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -467,9 +550,9 @@ static inline FusionEuler FusionQuaternionToEuler(const FusionQuaternion quatern
 #define Q quaternion.element
     const float halfMinusQySquared = 0.5f - Q.y * Q.y; // calculate common terms to avoid repeated operations
     const FusionEuler euler = {.angle = {
-            .roll = FusionRadiansToDegrees(atan2f(Q.w * Q.x + Q.y * Q.z, halfMinusQySquared - Q.x * Q.x)),
+            .roll = FusionRadiansToDegrees(FusionAtan2(Q.w * Q.x + Q.y * Q.z, halfMinusQySquared - Q.x * Q.x)),
             .pitch = FusionRadiansToDegrees(FusionAsin(2.0f * (Q.w * Q.y - Q.z * Q.x))),
-            .yaw = FusionRadiansToDegrees(atan2f(Q.w * Q.z + Q.x * Q.y, halfMinusQySquared - Q.z * Q.z)),
+            .yaw = FusionRadiansToDegrees(FusionAtan2(Q.w * Q.z + Q.x * Q.y, halfMinusQySquared - Q.z * Q.z)),
     }};
     return euler;
 #undef Q
@@ -73,5 +73,25 @@ FusionVector FusionOffsetUpdate(FusionOffset *const offset, FusionVector gyrosco
     return gyroscope;
 }
 
+/**
+ * @brief Returns the gyroscope offset.
+ * @param offset Gyroscope offset algorithm structure.
+ * @return Gyroscope offset in degrees per second.
+ */
+FusionVector FusionOffsetGetOffset(const FusionOffset *const offset) {
+    return offset->gyroscopeOffset;
+}
+
+/**
+ * @brief Sets the gyroscope offset, e.g. from a start-up calibration or a
+ * value stored from a previous run, so that the algorithm does not have to
+ * converge from zero.
+ * @param offset Gyroscope offset algorithm structure.
+ * @param gyroscopeOffset Gyroscope offset in degrees per second.
+ */
+void FusionOffsetSetOffset(FusionOffset *const offset, const FusionVector gyroscopeOffset) {
+    offset->gyroscopeOffset = gyroscopeOffset;
+}
+
 //------------------------------------------------------------------------------
 // End of file
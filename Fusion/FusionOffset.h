@@ -34,6 +34,10 @@ void FusionOffsetInitialise(FusionOffset *const offset, const unsigned int sampl
 
 FusionVector FusionOffsetUpdate(FusionOffset *const offset, FusionVector gyroscope);
 
+FusionVector FusionOffsetGetOffset(const FusionOffset *const offset);
+
+void FusionOffsetSetOffset(FusionOffset *const offset, const FusionVector gyroscopeOffset);
+
 #endif
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,240 @@
+// Runs FusionAhrsUpdateBatch and per-sample FusionAhrsUpdate (or
+// FusionAhrsUpdateNoMagnetometer without a magnetometer) over the same
+// synthetic session, checks that the whole algorithm state is bit-identical
+// after every block and prints the speed of both.
+//
+//   ahrs_batch_check [-n samples] [-r repeats]
+//
+// The session mixes still and moving stretches with gyroscope over-range
+// bursts, zero accelerometer and magnetometer samples and strong linear
+// accelerations, and is cut into blocks of random size. Every combination
+// of convention, magnetometer, fixed or per-sample delta time, gyroscope
+// range and recovery period is checked. Exits with 1 on any difference.
+
+#include "Fusion.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SAMPLE_PERIOD 0.01f
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned next_random(unsigned *state) {
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 8;
+}
+
+static float random_float(unsigned *state) {
+    return (next_random(state) & 0xFFFFFF) / (float)0x800000 - 1.0f; // -1 to 1
+}
+
+typedef struct {
+    FusionVector *gyroscope;
+    FusionVector *accelerometer;
+    FusionVector *magnetometer;
+    float *deltaTimes;
+    size_t count;
+} session_t;
+
+static void make_session(session_t *s, size_t count, unsigned seed) {
+    s->gyroscope = malloc(count * sizeof(FusionVector));
+    s->accelerometer = malloc(count * sizeof(FusionVector));
+    s->magnetometer = malloc(count * sizeof(FusionVector));
+    s->deltaTimes = malloc(count * sizeof(float));
+    s->count = count;
+
+    float roll = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const float t = i * SAMPLE_PERIOD;
+        const float rate = 90.0f * sinf(t * 1.3f) * (sinf(t * 0.2f) > 0.0f ? 1.0f : 0.0f);
+        roll += rate * SAMPLE_PERIOD;
+        const float r = FusionDegreesToRadians(roll);
+
+        FusionVector g = {.axis = {rate + 0.5f * random_float(&seed), 0.5f * random_float(&seed), 0.5f * random_float(&seed)}};
+        FusionVector a = {.axis = {0.01f * random_float(&seed), sinf(r), cosf(r)}};
+        FusionVector m = {.axis = {0.4f + 0.01f * random_float(&seed), 0.1f * cosf(r), -0.3f * sinf(r)}};
+
+        const unsigned event = next_random(&seed) % 1000;
+        if (event < 5) { // gyroscope over-range burst
+            g.axis.x = 2500.0f * (event & 1 ? 1.0f : -1.0f);
+        } else if (event < 10) {
+            a = FUSION_VECTOR_ZERO;
+        } else if (event < 15) {
+            m = FUSION_VECTOR_ZERO;
+        } else if (event < 60) { // linear acceleration, rejected
+            a.axis.x += 2.0f * random_float(&seed);
+            a.axis.y += 2.0f * random_float(&seed);
+        }
+        s->gyroscope[i] = g;
+        s->accelerometer[i] = a;
+        s->magnetometer[i] = m;
+        s->deltaTimes[i] = SAMPLE_PERIOD * (1.0f + 0.1f * random_float(&seed));
+    }
+}
+
+static void free_session(session_t *s) {
+    free(s->gyroscope);
+    free(s->accelerometer);
+    free(s->magnetometer);
+    free(s->deltaTimes);
+}
+
+static bool same_bits(const void *a, const void *b, size_t size) {
+    return memcmp(a, b, size) == 0;
+}
+
+// Field by field, so that padding bytes do not count
+static bool same_state(const FusionAhrs *a, const FusionAhrs *b) {
+    return same_bits(&a->quaternion, &b->quaternion, sizeof(a->quaternion)) &&
+           same_bits(&a->accelerometer, &b->accelerometer, sizeof(a->accelerometer)) &&
+           a->initialising == b->initialising &&
+           same_bits(&a->rampedGain, &b->rampedGain, sizeof(float)) &&
+           same_bits(&a->rampedGainStep, &b->rampedGainStep, sizeof(float)) &&
+           a->angularRateRecovery == b->angularRateRecovery &&
+           same_bits(&a->halfAccelerometerFeedback, &b->halfAccelerometerFeedback, sizeof(FusionVector)) &&
+           same_bits(&a->halfMagnetometerFeedback, &b->halfMagnetometerFeedback, sizeof(FusionVector)) &&
+           a->accelerometerIgnored == b->accelerometerIgnored &&
+           a->accelerationRecoveryTrigger == b->accelerationRecoveryTrigger &&
+           a->accelerationRecoveryTimeout == b->accelerationRecoveryTimeout &&
+           a->magnetometerIgnored == b->magnetometerIgnored &&
+           a->magneticRecoveryTrigger == b->magneticRecoveryTrigger &&
+           a->magneticRecoveryTimeout == b->magneticRecoveryTimeout;
+}
+
+static void update_scalar(FusionAhrs *ahrs, const session_t *s, size_t first, size_t count,
+                          bool magnetometer, bool per_sample_dt) {
+    for (size_t i = first; i < first + count; i++) {
+        const float dt = per_sample_dt ? s->deltaTimes[i] : SAMPLE_PERIOD;
+        if (magnetometer)
+            FusionAhrsUpdate(ahrs, s->gyroscope[i], s->accelerometer[i], s->magnetometer[i], dt);
+        else
+            FusionAhrsUpdateNoMagnetometer(ahrs, s->gyroscope[i], s->accelerometer[i], dt);
+    }
+}
+
+static void update_batch(FusionAhrs *ahrs, const session_t *s, size_t first, size_t count,
+                         bool magnetometer, bool per_sample_dt) {
+    FusionAhrsUpdateBatch(ahrs, s->gyroscope + first, s->accelerometer + first,
+                          magnetometer ? s->magnetometer + first : NULL,
+                          per_sample_dt ? s->deltaTimes + first : NULL, SAMPLE_PERIOD, count);
+}
+
+static void init_ahrs(FusionAhrs *ahrs, FusionConvention convention, float gyroscopeRange,
+                      unsigned recoveryTriggerPeriod) {
+    const FusionAhrsSettings settings = {
+            .convention = convention,
+            .gain = 0.5f,
+            .gyroscopeRange = gyroscopeRange,
+            .accelerationRejection = 10.0f,
+            .magneticRejection = 10.0f,
+            .recoveryTriggerPeriod = recoveryTriggerPeriod,
+    };
+    memset(ahrs, 0, sizeof(*ahrs));
+    FusionAhrsInitialise(ahrs);
+    FusionAhrsSetSettings(ahrs, &settings);
+}
+
+// Returns the number of blocks after which the two states differ
+static unsigned compare(const session_t *s, FusionConvention convention, bool magnetometer,
+                        bool per_sample_dt, float gyroscopeRange, unsigned recoveryTriggerPeriod,
+                        unsigned seed) {
+    FusionAhrs scalar, batch;
+    init_ahrs(&scalar, convention, gyroscopeRange, recoveryTriggerPeriod);
+    init_ahrs(&batch, convention, gyroscopeRange, recoveryTriggerPeriod);
+
+    unsigned differences = 0;
+    size_t first = 0;
+    while (first < s->count) {
+        size_t count = 1 + next_random(&seed) % 200;
+        if (count > s->count - first)
+            count = s->count - first;
+        update_scalar(&scalar, s, first, count, magnetometer, per_sample_dt);
+        update_batch(&batch, s, first, count, magnetometer, per_sample_dt);
+        if (!same_state(&scalar, &batch)) {
+            if (differences == 0)
+                printf("convention %d, %s magnetometer, %s dt, range %g, recovery %u: "
+                       "differs after sample %zu\n", (int)convention,
+                       magnetometer ? "with" : "no", per_sample_dt ? "per-sample" : "fixed",
+                       gyroscopeRange, recoveryTriggerPeriod, first + count);
+            differences++;
+            batch = scalar; // keep comparing the following blocks
+        }
+        first += count;
+    }
+    return differences;
+}
+
+static double time_update(const session_t *s, bool batch, bool magnetometer, int repeats) {
+    double best = INFINITY;
+    for (int r = 0; r < repeats; r++) {
+        FusionAhrs ahrs;
+        init_ahrs(&ahrs, FusionConventionNwu, 2000.0f, 500);
+        const double t0 = now_s();
+        if (batch)
+            update_batch(&ahrs, s, 0, s->count, magnetometer, false);
+        else
+            update_scalar(&ahrs, s, 0, s->count, magnetometer, false);
+        const double t = now_s() - t0;
+        volatile float sink = ahrs.quaternion.element.w;
+        (void)sink;
+        if (t < best)
+            best = t;
+    }
+    return best * 1e9 / s->count;
+}
+
+int main(int argc, char **argv) {
+    size_t samples = 200000;
+    int repeats = 5;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+        case 'n': samples = strtoul(optarg, NULL, 0); break;
+        case 'r': repeats = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples] [-r repeats]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (samples == 0)
+        samples = 1;
+
+    session_t s;
+    make_session(&s, samples, 1);
+
+    static const FusionConvention conventions[] = {FusionConventionNwu, FusionConventionEnu, FusionConventionNed};
+    static const float ranges[] = {0.0f, 2000.0f};
+    static const unsigned periods[] = {0, 500};
+    unsigned cases = 0, failed = 0, seed = 7;
+    for (int c = 0; c < 3; c++)
+        for (int m = 0; m < 2; m++)
+            for (int d = 0; d < 2; d++)
+                for (int g = 0; g < 2; g++)
+                    for (int p = 0; p < 2; p++) {
+                        cases++;
+                        if (compare(&s, conventions[c], m, d, ranges[g], periods[p], seed++))
+                            failed++;
+                    }
+    printf("%u combinations, %zu samples each: %s\n", cases, samples,
+           failed ? "FAIL" : "bit-identical");
+
+    for (int m = 0; m < 2; m++) {
+        const double scalar = time_update(&s, false, m, repeats);
+        const double batch = time_update(&s, true, m, repeats);
+        printf("%-17s per-sample %6.1f ns  batch %6.1f ns  x%.2f\n",
+               m ? "with magnetometer" : "no magnetometer", scalar, batch, scalar / batch);
+    }
+
+    free_session(&s);
+    return failed ? 1 : 0;
+}
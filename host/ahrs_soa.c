@@ -0,0 +1,357 @@
+#include "ahrs_soa.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_GAIN (10.0f) // same as FusionAhrs.c
+
+typedef ahrs_soa_float_t vf;
+typedef ahrs_soa_int_t vi;
+
+// One FusionAhrs per lane. Booleans are lane masks (-1 true, 0 false).
+typedef struct {
+    ahrs_soa_quaternion_t q;
+    vf ramped_gain;
+    vf half_acc_fb_x, half_acc_fb_y, half_acc_fb_z;
+    vi initialising;
+    vi angular_rate_recovery;
+    vi accelerometer_ignored;
+    vi acc_trigger;
+    vi acc_timeout;
+    vi reset; // the last sample reinitialised the lane (accelerometer zeroed)
+
+    // Settings, already processed by FusionAhrsSetSettings
+    vf gain;
+    vf ramped_gain_step;
+    vf gyroscope_range;
+    vf acceleration_rejection;
+    vi recovery_period;
+} block_t;
+
+struct ahrs_soa {
+    size_t instances;
+    size_t blocks;
+    FusionConvention convention;
+    FusionVector accelerometer; // last sample, shared by all instances
+    FusionAhrs *scalar;         // settings and the fields no update touches
+    block_t *block;
+};
+
+static inline vf select_f(vi mask, vf a, vf b) {
+    return (vf)((mask & (vi)a) | (~mask & (vi)b));
+}
+
+static inline vi select_i(vi mask, vi a, vi b) {
+    return (mask & a) | (~mask & b);
+}
+
+static inline bool any(vi mask) {
+    for (int i = 0; i < AHRS_SOA_LANES; i++)
+        if (mask[i])
+            return true;
+    return false;
+}
+
+// FusionFastInverseSqrt, lane-wise
+static inline vf fast_inverse_sqrt(vf x) {
+    vi i = (vi)x;
+    i = 0x5F1F1412 - (i >> 1);
+    vf f = (vf)i;
+    return f * (1.69000231f - 0.714158168f * x * f * f);
+}
+
+ahrs_soa_t *ahrs_soa_create(const FusionAhrsSettings *settings,
+                            size_t instances) {
+    if (instances == 0)
+        return NULL;
+    for (size_t i = 1; i < instances; i++)
+        if (settings[i].convention != settings[0].convention)
+            return NULL;
+
+    ahrs_soa_t *soa = calloc(1, sizeof(*soa));
+    if (!soa)
+        return NULL;
+    soa->instances = instances;
+    soa->blocks = (instances + AHRS_SOA_LANES - 1) / AHRS_SOA_LANES;
+    soa->convention = settings[0].convention;
+    soa->scalar = calloc(instances, sizeof(FusionAhrs));
+    soa->block = aligned_alloc(64, ((soa->blocks * sizeof(block_t) + 63) / 64) * 64);
+    if (!soa->scalar || !soa->block) {
+        ahrs_soa_free(soa);
+        return NULL;
+    }
+    memset(soa->block, 0, soa->blocks * sizeof(block_t));
+
+    for (size_t b = 0; b < soa->blocks; b++) {
+        block_t *blk = &soa->block[b];
+        for (int lane = 0; lane < AHRS_SOA_LANES; lane++) {
+            size_t i = b * AHRS_SOA_LANES + lane;
+            // Padding lanes run a copy of the last instance
+            FusionAhrs ahrs;
+            FusionAhrsInitialise(&ahrs);
+            FusionAhrsSetSettings(&ahrs, &settings[i < instances ? i : instances - 1]);
+            FusionAhrsReset(&ahrs);
+            if (i < instances)
+                soa->scalar[i] = ahrs;
+
+            blk->q.w[lane] = ahrs.quaternion.element.w;
+            blk->q.x[lane] = ahrs.quaternion.element.x;
+            blk->q.y[lane] = ahrs.quaternion.element.y;
+            blk->q.z[lane] = ahrs.quaternion.element.z;
+            blk->ramped_gain[lane] = ahrs.rampedGain;
+            blk->initialising[lane] = ahrs.initialising ? -1 : 0;
+            blk->angular_rate_recovery[lane] = ahrs.angularRateRecovery ? -1 : 0;
+            blk->accelerometer_ignored[lane] = ahrs.accelerometerIgnored ? -1 : 0;
+            blk->acc_trigger[lane] = ahrs.accelerationRecoveryTrigger;
+            blk->acc_timeout[lane] = ahrs.accelerationRecoveryTimeout;
+            blk->gain[lane] = ahrs.settings.gain;
+            blk->ramped_gain_step[lane] = ahrs.rampedGainStep;
+            blk->gyroscope_range[lane] = ahrs.settings.gyroscopeRange;
+            blk->acceleration_rejection[lane] = ahrs.settings.accelerationRejection;
+            blk->recovery_period[lane] = (int)ahrs.settings.recoveryTriggerPeriod;
+        }
+    }
+    return soa;
+}
+
+void ahrs_soa_free(ahrs_soa_t *soa) {
+    if (!soa)
+        return;
+    free(soa->scalar);
+    free(soa->block);
+    free(soa);
+}
+
+size_t ahrs_soa_blocks(const ahrs_soa_t *soa) {
+    return soa->blocks;
+}
+
+// FusionAhrsUpdate with a zero magnetometer followed by the heading reset of
+// FusionAhrsUpdateNoMagnetometer, for one block and one sample. Comments
+// name the matching steps in FusionAhrs.c.
+static inline void update_block(block_t *b, const FusionVector gyroscope,
+                                const FusionVector accelerometer,
+                                const float delta_time,
+                                const FusionConvention convention) {
+    const vi all = (vi){0} - 1;
+
+    // Reinitialise if gyroscope range exceeded
+    const vi exceeded = (fabsf(gyroscope.axis.x) > b->gyroscope_range) |
+                        (fabsf(gyroscope.axis.y) > b->gyroscope_range) |
+                        (fabsf(gyroscope.axis.z) > b->gyroscope_range);
+    b->reset = exceeded;
+    if (any(exceeded)) {
+        const vf zero = {0};
+        b->initialising |= exceeded;
+        b->ramped_gain = select_f(exceeded, zero + INITIAL_GAIN, b->ramped_gain);
+        b->angular_rate_recovery |= exceeded;
+        b->half_acc_fb_x = select_f(exceeded, zero, b->half_acc_fb_x);
+        b->half_acc_fb_y = select_f(exceeded, zero, b->half_acc_fb_y);
+        b->half_acc_fb_z = select_f(exceeded, zero, b->half_acc_fb_z);
+        b->accelerometer_ignored &= ~exceeded;
+        b->acc_trigger = select_i(exceeded, (vi){0}, b->acc_trigger);
+        b->acc_timeout = select_i(exceeded, b->recovery_period, b->acc_timeout);
+    }
+
+    // Ramp down gain during initialisation
+    if (any(b->initialising)) {
+        const vf ramped = b->ramped_gain - b->ramped_gain_step * delta_time;
+        const vi done = b->initialising & ((ramped < b->gain) | (b->gain == 0.0f));
+        b->ramped_gain = select_f(b->initialising, select_f(done, b->gain, ramped), b->ramped_gain);
+        b->initialising &= ~done;
+        b->angular_rate_recovery &= ~done;
+    }
+
+    // Calculate direction of gravity indicated by algorithm
+    const ahrs_soa_quaternion_t q = b->q;
+    vf hg_x, hg_y, hg_z;
+    if (convention == FusionConventionNed) {
+        hg_x = q.w * q.y - q.x * q.z;
+        hg_y = -1.0f * (q.y * q.z + q.w * q.x);
+        hg_z = 0.5f - q.w * q.w - q.z * q.z;
+    } else {
+        hg_x = q.x * q.z - q.w * q.y;
+        hg_y = q.y * q.z + q.w * q.x;
+        hg_z = q.w * q.w - 0.5f + q.z * q.z;
+    }
+
+    // Calculate accelerometer feedback
+    vf fb_x = {0}, fb_y = {0}, fb_z = {0};
+    b->accelerometer_ignored = all;
+    if (FusionVectorIsZero(accelerometer) == false) {
+        const FusionVector n = FusionVectorNormalise(accelerometer);
+
+        // Feedback(): cross product, normalised if error is >90 degrees
+        vf c_x = n.axis.y * hg_z - n.axis.z * hg_y;
+        vf c_y = n.axis.z * hg_x - n.axis.x * hg_z;
+        vf c_z = n.axis.x * hg_y - n.axis.y * hg_x;
+        const vi obtuse = (n.axis.x * hg_x + n.axis.y * hg_y + n.axis.z * hg_z) < 0.0f;
+        if (any(obtuse)) {
+            const vf r = fast_inverse_sqrt(c_x * c_x + c_y * c_y + c_z * c_z);
+            c_x = select_f(obtuse, c_x * r, c_x);
+            c_y = select_f(obtuse, c_y * r, c_y);
+            c_z = select_f(obtuse, c_z * r, c_z);
+        }
+        b->half_acc_fb_x = c_x;
+        b->half_acc_fb_y = c_y;
+        b->half_acc_fb_z = c_z;
+
+        // Don't ignore accelerometer if acceleration error below threshold
+        const vi accept = b->initialising |
+                          ((c_x * c_x + c_y * c_y + c_z * c_z) <= b->acceleration_rejection);
+        b->accelerometer_ignored = ~accept;
+        b->acc_trigger = select_i(accept, b->acc_trigger - 9, b->acc_trigger + 1);
+
+        // Don't ignore accelerometer during acceleration recovery
+        const vi recovering = b->acc_trigger > b->acc_timeout;
+        b->acc_timeout = select_i(recovering, (vi){0}, b->recovery_period);
+        b->accelerometer_ignored &= ~recovering;
+        b->acc_trigger = select_i(b->acc_trigger < 0, (vi){0}, b->acc_trigger);
+        b->acc_trigger = select_i(b->acc_trigger > b->recovery_period, b->recovery_period, b->acc_trigger);
+
+        // Apply accelerometer feedback
+        const vf zero = {0};
+        fb_x = select_f(b->accelerometer_ignored, zero, c_x);
+        fb_y = select_f(b->accelerometer_ignored, zero, c_y);
+        fb_z = select_f(b->accelerometer_ignored, zero, c_z);
+    }
+
+    // Convert gyroscope to radians per second scaled by 0.5
+    const FusionVector half_gyro = FusionVectorMultiplyScalar(gyroscope, FusionDegreesToRadians(0.5f));
+
+    // Apply feedback to gyroscope (the zero magnetometer feedback included)
+    const vf a_x = half_gyro.axis.x + (fb_x + 0.0f) * b->ramped_gain;
+    const vf a_y = half_gyro.axis.y + (fb_y + 0.0f) * b->ramped_gain;
+    const vf a_z = half_gyro.axis.z + (fb_z + 0.0f) * b->ramped_gain;
+
+    // Integrate rate of change of quaternion
+    const vf v_x = a_x * delta_time, v_y = a_y * delta_time, v_z = a_z * delta_time;
+    const vf w = q.w + (-q.x * v_x - q.y * v_y - q.z * v_z);
+    const vf x = q.x + (q.w * v_x + q.y * v_z - q.z * v_y);
+    const vf y = q.y + (q.w * v_y - q.x * v_z + q.z * v_x);
+    const vf z = q.z + (q.w * v_z + q.x * v_y - q.y * v_x);
+
+    // Normalise quaternion
+    const vf r = fast_inverse_sqrt(w * w + x * x + y * y + z * z);
+    b->q.w = w * r;
+    b->q.x = x * r;
+    b->q.y = y * r;
+    b->q.z = z * r;
+
+    // Zero heading during initialisation
+    if (any(b->initialising)) {
+        for (int lane = 0; lane < AHRS_SOA_LANES; lane++) {
+            if (!b->initialising[lane])
+                continue;
+            FusionAhrs ahrs;
+            ahrs.quaternion = (FusionQuaternion){.element = {
+                    b->q.w[lane], b->q.x[lane], b->q.y[lane], b->q.z[lane]}};
+            FusionAhrsSetHeading(&ahrs, 0.0f);
+            b->q.w[lane] = ahrs.quaternion.element.w;
+            b->q.x[lane] = ahrs.quaternion.element.x;
+            b->q.y[lane] = ahrs.quaternion.element.y;
+            b->q.z[lane] = ahrs.quaternion.element.z;
+        }
+    }
+}
+
+typedef struct {
+    ahrs_soa_t *soa;
+    size_t first_block, end_block;
+    const FusionVector *gyroscope, *accelerometer;
+    const float *delta_time;
+    size_t samples;
+    ahrs_soa_observer_t observer;
+    void *ctx;
+} job_t;
+
+static inline void run_job(const job_t *job, const FusionConvention convention) {
+    for (size_t blk = job->first_block; blk < job->end_block; blk++) {
+        block_t b = job->soa->block[blk]; // work on a local copy
+        for (size_t s = 0; s < job->samples; s++) {
+            update_block(&b, job->gyroscope[s], job->accelerometer[s],
+                         job->delta_time[s], convention);
+            if (job->observer)
+                job->observer(job->ctx, s, blk, &b.q);
+        }
+        job->soa->block[blk] = b;
+    }
+}
+
+static void *run_thread(void *arg) {
+    const job_t *job = arg;
+    // Resolve the convention once so each copy of the kernel is specialised
+    switch (job->soa->convention) {
+    case FusionConventionNwu:
+        run_job(job, FusionConventionNwu);
+        break;
+    case FusionConventionEnu:
+        run_job(job, FusionConventionEnu);
+        break;
+    case FusionConventionNed:
+        run_job(job, FusionConventionNed);
+        break;
+    }
+    return NULL;
+}
+
+// Runs every instance over the samples. May be called repeatedly with
+// consecutive chunks of a log; state carries over.
+void ahrs_soa_update_no_magnetometer(ahrs_soa_t *soa,
+                                     const FusionVector *gyroscope,
+                                     const FusionVector *accelerometer,
+                                     const float *delta_time, size_t samples,
+                                     unsigned threads,
+                                     ahrs_soa_observer_t observer, void *ctx) {
+    if (samples == 0)
+        return;
+    if (threads == 0)
+        threads = 1;
+    if (threads > soa->blocks)
+        threads = soa->blocks;
+
+    job_t jobs[threads];
+    pthread_t tid[threads];
+    size_t per = soa->blocks / threads, extra = soa->blocks % threads;
+    size_t next = 0;
+
+    for (unsigned t = 0; t < threads; t++) {
+        size_t n = per + (t < extra);
+        jobs[t] = (job_t){soa, next, next + n, gyroscope, accelerometer,
+                          delta_time, samples, observer, ctx};
+        next += n;
+    }
+
+    for (unsigned t = 1; t < threads; t++)
+        if (pthread_create(&tid[t], NULL, run_thread, &jobs[t]) != 0)
+            run_thread(&jobs[t]), tid[t] = 0;
+    run_thread(&jobs[0]);
+    for (unsigned t = 1; t < threads; t++)
+        if (tid[t])
+            pthread_join(tid[t], NULL);
+
+    soa->accelerometer = accelerometer[samples - 1];
+}
+
+// Fills a FusionAhrs as if the instance had been run with the scalar API
+void ahrs_soa_get_ahrs(const ahrs_soa_t *soa, size_t instance,
+                       FusionAhrs *ahrs) {
+    const block_t *b = &soa->block[instance / AHRS_SOA_LANES];
+    const int lane = instance % AHRS_SOA_LANES;
+
+    *ahrs = soa->scalar[instance];
+    ahrs->quaternion = (FusionQuaternion){.element = {
+            b->q.w[lane], b->q.x[lane], b->q.y[lane], b->q.z[lane]}};
+    ahrs->accelerometer = b->reset[lane] ? FUSION_VECTOR_ZERO : soa->accelerometer;
+    ahrs->initialising = b->initialising[lane] != 0;
+    ahrs->rampedGain = b->ramped_gain[lane];
+    ahrs->angularRateRecovery = b->angular_rate_recovery[lane] != 0;
+    ahrs->halfAccelerometerFeedback = (FusionVector){.axis = {
+            b->half_acc_fb_x[lane], b->half_acc_fb_y[lane], b->half_acc_fb_z[lane]}};
+    ahrs->accelerometerIgnored = b->accelerometer_ignored[lane] != 0;
+    ahrs->accelerationRecoveryTrigger = b->acc_trigger[lane];
+    ahrs->accelerationRecoveryTimeout = b->acc_timeout[lane];
+    ahrs->magnetometerIgnored = true;
+}
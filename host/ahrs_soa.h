@@ -0,0 +1,65 @@
+#ifndef AHRS_SOA_H
+#define AHRS_SOA_H
+
+#include "Fusion.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Many independent FusionAhrs instances (e.g. one per candidate setting)
+// fed with the same IMU samples, for parameter sweeps over long logs.
+//
+// State is kept structure-of-arrays in blocks of AHRS_SOA_LANES instances
+// and each block is updated with GCC vector types, so one instruction
+// covers a whole block (SSE/AVX/NEON depending on -march). Blocks are
+// spread over threads. Only the no-magnetometer path is provided; that is
+// what the MPU6050 firmware runs.
+//
+// Results are bit-identical to FusionAhrsUpdateNoMagnetometer as long as
+// both sides are built with -ffp-contract=off and without -ffast-math: the
+// kernel performs the same float operations in the same order, with the
+// data-dependent branches turned into lane selects.
+
+// One AVX register per vector where the target has it, one SSE/NEON
+// register otherwise
+#ifndef AHRS_SOA_LANES
+#ifdef __AVX__
+#define AHRS_SOA_LANES 8
+#else
+#define AHRS_SOA_LANES 4
+#endif
+#endif
+
+typedef float ahrs_soa_float_t
+    __attribute__((vector_size(AHRS_SOA_LANES * sizeof(float))));
+typedef int32_t ahrs_soa_int_t
+    __attribute__((vector_size(AHRS_SOA_LANES * sizeof(int32_t))));
+
+typedef struct {
+    ahrs_soa_float_t w, x, y, z;
+} ahrs_soa_quaternion_t;
+
+// Called after every sample for each block; block covers instances
+// block * AHRS_SOA_LANES onwards. Runs concurrently for different blocks
+// when threads > 1.
+typedef void (*ahrs_soa_observer_t)(void *ctx, size_t sample, size_t block,
+                                    const ahrs_soa_quaternion_t *quaternion);
+
+typedef struct ahrs_soa ahrs_soa_t;
+
+ahrs_soa_t *ahrs_soa_create(const FusionAhrsSettings *settings,
+                            size_t instances);
+void ahrs_soa_free(ahrs_soa_t *soa);
+size_t ahrs_soa_blocks(const ahrs_soa_t *soa);
+
+void ahrs_soa_update_no_magnetometer(ahrs_soa_t *soa,
+                                     const FusionVector *gyroscope,
+                                     const FusionVector *accelerometer,
+                                     const float *delta_time, size_t samples,
+                                     unsigned threads,
+                                     ahrs_soa_observer_t observer, void *ctx);
+
+void ahrs_soa_get_ahrs(const ahrs_soa_t *soa, size_t instance,
+                       FusionAhrs *ahrs);
+
+#endif // AHRS_SOA_H
@@ -0,0 +1,166 @@
+// Runs a grid of FusionAhrsSettings over an IMU log twice, with the scalar
+// FusionAhrsUpdateNoMagnetometer and with the ahrs_soa engine, checks that
+// every quaternion of every instance is bit-identical and prints the speed
+// of both.
+//
+//   ahrs_soa_check [-l log.csv] [-n synthetic_samples] [-i instances]
+//                  [-t threads] [-c convention: 0 NWU, 1 ENU, 2 NED]
+
+#include "ahrs_soa.h"
+#include "imu_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t hash_quaternion(uint64_t h, FusionQuaternion q) {
+    uint8_t bytes[sizeof(q)];
+    memcpy(bytes, &q, sizeof(q));
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        h = (h ^ bytes[i]) * 0x100000001B3ull;
+    return h;
+}
+
+typedef struct {
+    uint64_t *hash;
+    size_t instances;
+} hashes_t;
+
+static void observe(void *ctx, size_t sample, size_t block,
+                    const ahrs_soa_quaternion_t *q) {
+    (void)sample;
+    hashes_t *h = ctx;
+    for (int lane = 0; lane < AHRS_SOA_LANES; lane++) {
+        size_t i = block * AHRS_SOA_LANES + lane;
+        if (i >= h->instances)
+            break;
+        FusionQuaternion fq = {.element = {q->w[lane], q->x[lane], q->y[lane], q->z[lane]}};
+        h->hash[i] = hash_quaternion(h->hash[i], fq);
+    }
+}
+
+static bool same_state(const FusionAhrs *a, const FusionAhrs *b) {
+    return memcmp(&a->quaternion, &b->quaternion, sizeof(a->quaternion)) == 0 &&
+           memcmp(&a->accelerometer, &b->accelerometer, sizeof(a->accelerometer)) == 0 &&
+           a->initialising == b->initialising &&
+           memcmp(&a->rampedGain, &b->rampedGain, sizeof(float)) == 0 &&
+           a->angularRateRecovery == b->angularRateRecovery &&
+           memcmp(&a->halfAccelerometerFeedback, &b->halfAccelerometerFeedback, sizeof(FusionVector)) == 0 &&
+           a->accelerometerIgnored == b->accelerometerIgnored &&
+           a->accelerationRecoveryTrigger == b->accelerationRecoveryTrigger &&
+           a->accelerationRecoveryTimeout == b->accelerationRecoveryTimeout &&
+           a->magnetometerIgnored == b->magnetometerIgnored;
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    size_t samples = 60000, instances = 256;
+    unsigned threads = 1;
+    FusionConvention convention = FusionConventionNwu;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:n:i:t:c:")) != -1) {
+        switch (opt) {
+        case 'l':
+            path = optarg;
+            break;
+        case 'n':
+            samples = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            instances = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            threads = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            convention = (FusionConvention)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l log.csv] [-n samples] [-i instances] [-t threads] [-c convention]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    imu_log_t log;
+    if (path ? !imu_log_read_csv(path, &log) : !imu_log_synthesize(&log, samples, 100.0f, 1)) {
+        fprintf(stderr, "cannot load %s\n", path ? path : "synthetic log");
+        return 1;
+    }
+
+    FusionAhrsSettings *settings = calloc(instances, sizeof(*settings));
+    for (size_t i = 0; i < instances; i++) {
+        settings[i] = (FusionAhrsSettings){
+                .convention = convention,
+                .gain = 0.1f + 0.1f * (i % 16),
+                .gyroscopeRange = 2000.0f,
+                .accelerationRejection = 2.0f + 2.0f * ((i / 16) % 8),
+                .magneticRejection = 0.0f,
+                .recoveryTriggerPeriod = (unsigned)(100 * ((i / 128) % 4)),
+        };
+    }
+
+    hashes_t scalar = {calloc(instances, sizeof(uint64_t)), instances};
+    hashes_t vector = {calloc(instances, sizeof(uint64_t)), instances};
+    FusionAhrs *final = calloc(instances, sizeof(FusionAhrs));
+
+    double t0 = now_s();
+    for (size_t i = 0; i < instances; i++) {
+        FusionAhrs *ahrs = &final[i];
+        FusionAhrsInitialise(ahrs);
+        FusionAhrsSetSettings(ahrs, &settings[i]);
+        for (size_t s = 0; s < log.count; s++) {
+            FusionAhrsUpdateNoMagnetometer(ahrs, log.gyroscope[s], log.accelerometer[s], log.delta_time[s]);
+            scalar.hash[i] = hash_quaternion(scalar.hash[i], ahrs->quaternion);
+        }
+    }
+    double t_scalar = now_s() - t0;
+
+    ahrs_soa_t *soa = ahrs_soa_create(settings, instances);
+    t0 = now_s();
+    ahrs_soa_update_no_magnetometer(soa, log.gyroscope, log.accelerometer, log.delta_time,
+                                    log.count, threads, observe, &vector);
+    double t_vector = now_s() - t0;
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < instances; i++) {
+        FusionAhrs got;
+        ahrs_soa_get_ahrs(soa, i, &got);
+        if (scalar.hash[i] != vector.hash[i] || !same_state(&final[i], &got)) {
+            if (mismatches++ < 5)
+                printf("instance %zu differs\n", i);
+        }
+    }
+    ahrs_soa_free(soa);
+
+    // Again without the observer, which is scalar per lane
+    soa = ahrs_soa_create(settings, instances);
+    t0 = now_s();
+    ahrs_soa_update_no_magnetometer(soa, log.gyroscope, log.accelerometer, log.delta_time,
+                                    log.count, threads, NULL, NULL);
+    double t_bare = now_s() - t0;
+    ahrs_soa_free(soa);
+
+    double updates = (double)instances * log.count;
+    printf("%zu instances x %zu samples, %d lanes, %u threads\n", instances, log.count,
+           AHRS_SOA_LANES, threads);
+    printf("scalar: %.1f ns/update\n", t_scalar * 1e9 / updates);
+    printf("soa:    %.1f ns/update (%.1f with observer), %.1fx\n", t_bare * 1e9 / updates,
+           t_vector * 1e9 / updates, t_scalar / t_bare);
+
+    if (mismatches) {
+        printf("%zu instances differ from the scalar path\n", mismatches);
+        return 1;
+    }
+    printf("all instances bit-identical to the scalar path\n");
+    return 0;
+}
@@ -0,0 +1,450 @@
+// Parameter sweep for the controller's tilt detection.
+//
+// Replays recorded sessions through many FusionAhrs configurations at once
+// (ahrs_soa engine, one instance per gain / acceleration rejection /
+// recovery period) and, for each of them, through every pair of tilt
+// thresholds with the same hysteresis logic as mpu6050_task. Each
+// combination is scored on:
+//
+//   - roll error: RMS difference to the reference roll, in degrees
+//   - latency: mean time from the reference crossing the intended tilt
+//     angle to the tilt event being sent (negative when the event comes
+//     first; the score counts early and late alike)
+//   - false triggers: tilt events with no reference crossing nearby
+//   - misses: reference crossings with no tilt event
+//
+// The reference roll is the log's roll_deg column when present, otherwise
+// the accelerometer tilt angle low-passed forwards and backwards (good for
+// the slow, deliberate tilts the gestures use).
+//
+//   ahrs_sweep [options] session.csv...
+//
+//   -g min:max:n  AHRS gain (default 0.1:1.0:10)
+//   -a min:max:n  acceleration rejection, degrees (default 5:40:8)
+//   -p min:max:n  recovery trigger period, samples (default 0:500:3)
+//   -e min:max:n  tilt enter angle, degrees (default 10:30:5)
+//   -x min:max:n  tilt exit as a fraction of enter (default 0.6:0.9:4)
+//   -r count      random search over the same ranges instead of the grid
+//   -s seed       seed for -r (default 1)
+//   -I degrees    intended tilt angle the reference is measured at (default 20)
+//   -G dps        gyroscope range, as set by imu_config in main.c; rates near
+//                 it reinitialise the AHRS (default 1000, MPU6050_GYRO_1000DPS)
+//   -t threads    (default: number of CPUs)
+//   -k rows       rows in the ranked table (default 10)
+//   -o path       write the best configuration as a C header, e.g.
+//                 main/ahrs_tuning.h
+//
+// With no session files a synthetic session is used.
+
+#include "ahrs_soa.h"
+#include "imu_log.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SETTLE_S 3.0f          // AHRS start-up ramp, not scored
+#define MATCH_WINDOW_S 0.5f    // reference crossing to event, at most
+#define EARLY_TOLERANCE_S 0.1f // event may precede the reference by this much
+
+// Score weights: one false trigger costs as much as 10 degrees RMS error
+#define WEIGHT_LATENCY_PER_100MS 1.0f
+#define WEIGHT_FALSE 10.0f
+#define WEIGHT_MISS 10.0f
+
+typedef struct {
+    float min, max;
+    unsigned n;
+} range_t;
+
+typedef struct {
+    int enter, exit; // firmware units: degrees converted to "degrees" again
+} tilt_pair_t;
+
+typedef struct {
+    bool left, right;
+    size_t next[2]; // next reference onset to match, per side
+    double latency_sum;
+    unsigned matched, false_triggers, misses;
+} tilt_state_t;
+
+typedef struct {
+    size_t sample;
+    int side; // 0 left, 1 right
+} onset_t;
+
+typedef struct {
+    double err_sq;
+    size_t err_n;
+    double latency_sum;
+    unsigned matched, false_triggers, misses;
+} score_t;
+
+typedef struct {
+    // Session being replayed
+    const imu_log_t *log;
+    const float *roll_ref;
+    const double *time;
+    size_t settle;
+    const onset_t *onsets[2];
+    size_t onset_count[2];
+
+    // Configurations
+    size_t instances;
+    const tilt_pair_t *pairs;
+    size_t pair_count;
+    tilt_state_t *state; // instances x pairs
+    score_t *score;      // instances x pairs, summed over sessions
+    double *err_sq;      // per instance, this session
+} sweep_t;
+
+static float range_value(const range_t *r, unsigned i) {
+    return r->n <= 1 ? r->min : r->min + (r->max - r->min) * i / (r->n - 1);
+}
+
+static bool parse_range(const char *s, range_t *r) {
+    return sscanf(s, "%f:%f:%u", &r->min, &r->max, &r->n) == 3 && r->n > 0;
+}
+
+static float uniform(unsigned *state, const range_t *r) {
+    *state = *state * 1103515245u + 12345u;
+    return r->min + (r->max - r->min) * ((*state >> 8) & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+// Degrees as mpu6050_task compares them: the Euler roll (already degrees)
+// goes through FusionRadiansToDegrees once more
+static int firmware_units(float degrees) {
+    return (int)lroundf(FusionRadiansToDegrees(degrees));
+}
+
+static float reference_from_accelerometer(const imu_log_t *log, float *roll) {
+    const float alpha = 0.05f;
+    float y = 0;
+    for (size_t i = 0; i < log->count; i++) {
+        const FusionVector a = log->accelerometer[i];
+        float x = FusionRadiansToDegrees(atan2f(a.axis.y, a.axis.z));
+        y = i ? y + alpha * (x - y) : x;
+        roll[i] = y;
+    }
+    for (size_t i = log->count; i-- > 0;) {
+        y = i + 1 < log->count ? y + alpha * (roll[i] - y) : roll[i];
+        roll[i] = y;
+    }
+    return alpha;
+}
+
+// Reference onsets: the reference roll crossing the intended angle, with
+// the same enter/exit hysteresis shape as the firmware
+static size_t find_onsets(const float *roll, size_t count, float intended,
+                          int side, onset_t *out) {
+    size_t n = 0;
+    bool active = false;
+    for (size_t i = 0; i < count; i++) {
+        float r = side ? roll[i] : -roll[i];
+        if (!active && r > intended) {
+            active = true;
+            out[n++] = (onset_t){i, side};
+        } else if (active && r < intended * 0.75f) {
+            active = false;
+        }
+    }
+    return n;
+}
+
+static void tilt_event(sweep_t *sw, tilt_state_t *st, size_t sample, int side) {
+    const onset_t *on = sw->onsets[side];
+    size_t n = sw->onset_count[side];
+    double t = sw->time[sample];
+
+    while (st->next[side] < n && sw->time[on[st->next[side]].sample] < t - MATCH_WINDOW_S) {
+        st->misses++;
+        st->next[side]++;
+    }
+    if (st->next[side] < n && sw->time[on[st->next[side]].sample] <= t + EARLY_TOLERANCE_S) {
+        st->latency_sum += t - sw->time[on[st->next[side]].sample];
+        st->matched++;
+        st->next[side]++;
+    } else {
+        st->false_triggers++;
+    }
+}
+
+static void observe(void *ctx, size_t sample, size_t block,
+                    const ahrs_soa_quaternion_t *q) {
+    sweep_t *sw = ctx;
+
+    for (int lane = 0; lane < AHRS_SOA_LANES; lane++) {
+        size_t inst = block * AHRS_SOA_LANES + lane;
+        if (inst >= sw->instances)
+            return;
+
+        const FusionQuaternion fq = {.element = {q->w[lane], q->x[lane], q->y[lane], q->z[lane]}};
+        const float roll_deg = FusionQuaternionToEuler(fq).angle.roll;
+        const float roll = FusionRadiansToDegrees(roll_deg); // as mpu6050_task
+
+        if (sample >= sw->settle) {
+            float e = roll_deg - sw->roll_ref[sample];
+            sw->err_sq[inst] += (double)e * e;
+        }
+
+        for (size_t p = 0; p < sw->pair_count; p++) {
+            tilt_state_t *st = &sw->state[inst * sw->pair_count + p];
+            const float enter = (float)sw->pairs[p].enter, exit = (float)sw->pairs[p].exit;
+
+            // Same decisions as mpu6050_task; an onset is the first event
+            // of a tilt
+            if (roll < -enter) {
+                if (!st->left && sample >= sw->settle)
+                    tilt_event(sw, st, sample, 0);
+                st->left = true;
+                st->right = false;
+            } else if (roll > enter) {
+                if (!st->right && sample >= sw->settle)
+                    tilt_event(sw, st, sample, 1);
+                st->right = true;
+                st->left = false;
+            } else if (roll >= -exit && roll <= exit) {
+                st->left = false;
+                st->right = false;
+            }
+        }
+    }
+}
+
+static double total_score(const score_t *s) {
+    double rms = s->err_n ? sqrt(s->err_sq / s->err_n) : 0;
+    double latency_ms = s->matched ? 1000.0 * s->latency_sum / s->matched : 0;
+    return rms + WEIGHT_LATENCY_PER_100MS * fabs(latency_ms) / 100.0 +
+           WEIGHT_FALSE * s->false_triggers + WEIGHT_MISS * s->misses;
+}
+
+static const score_t *rank_scores;
+
+static int by_score(const void *a, const void *b) {
+    double sa = total_score(&rank_scores[*(const size_t *)a]);
+    double sb = total_score(&rank_scores[*(const size_t *)b]);
+    return (sa > sb) - (sa < sb);
+}
+
+static bool write_header(const char *path, const FusionAhrsSettings *s,
+                         const tilt_pair_t *pair, const score_t *score,
+                         int argc, char **argv) {
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+
+    fprintf(f, "#ifndef AHRS_TUNING_H_\n#define AHRS_TUNING_H_\n\n");
+    fprintf(f, "// Generated by host/ahrs_sweep; do not edit by hand.\n//\n//  ");
+    for (int i = 0; i < argc; i++)
+        fprintf(f, " %s", argv[i]);
+    fprintf(f, "\n//\n// score %.2f: roll error %.2f deg RMS, latency %.0f ms, "
+               "%u false triggers, %u misses\n\n",
+            total_score(score), score->err_n ? sqrt(score->err_sq / score->err_n) : 0,
+            score->matched ? 1000.0 * score->latency_sum / score->matched : 0,
+            score->false_triggers, score->misses);
+    fprintf(f, "#define AHRS_TUNING_GAIN %.3ff\n", s->gain);
+    fprintf(f, "#define AHRS_TUNING_ACCELERATION_REJECTION %.1ff\n", s->accelerationRejection);
+    fprintf(f, "#define AHRS_TUNING_RECOVERY_TRIGGER_PERIOD %u\n\n", s->recoveryTriggerPeriod);
+    fprintf(f, "// mpu6050_task units (see tilt_enter in main.c)\n");
+    fprintf(f, "#define AHRS_TUNING_TILT_ENTER %d\n", pair->enter);
+    fprintf(f, "#define AHRS_TUNING_TILT_EXIT %d\n\n", pair->exit);
+    fprintf(f, "#endif // AHRS_TUNING_H_\n");
+    return fclose(f) == 0;
+}
+
+int main(int argc, char **argv) {
+    range_t gain = {0.1f, 1.0f, 10}, rejection = {5, 40, 8}, period = {0, 500, 3};
+    range_t enter = {10, 30, 5}, exit_frac = {0.6f, 0.9f, 4};
+    unsigned random = 0, seed = 1, top = 10;
+    unsigned threads = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+    float intended = 20.0f;
+    float gyro_range = 1000.0f;
+    const char *header = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:a:p:e:x:r:s:I:G:t:k:o:")) != -1) {
+        bool ok = true;
+        switch (opt) {
+        case 'g': ok = parse_range(optarg, &gain); break;
+        case 'a': ok = parse_range(optarg, &rejection); break;
+        case 'p': ok = parse_range(optarg, &period); break;
+        case 'e': ok = parse_range(optarg, &enter); break;
+        case 'x': ok = parse_range(optarg, &exit_frac); break;
+        case 'r': random = strtoul(optarg, NULL, 0); break;
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+        case 'I': intended = strtof(optarg, NULL); break;
+        case 'G': gyro_range = strtof(optarg, NULL); break;
+        case 't': threads = strtoul(optarg, NULL, 0); break;
+        case 'k': top = strtoul(optarg, NULL, 0); break;
+        case 'o': header = optarg; break;
+        default: ok = false; break;
+        }
+        if (!ok) {
+            fprintf(stderr, "usage: %s [-g|-a|-p|-e|-x min:max:n] [-r count] [-s seed] "
+                            "[-I degrees] [-G dps] [-t threads] [-k rows] [-o header] session.csv...\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    // AHRS configurations
+    size_t instances = random ? random : (size_t)gain.n * rejection.n * period.n;
+    FusionAhrsSettings *settings = calloc(instances, sizeof(*settings));
+    for (size_t i = 0; i < instances; i++) {
+        FusionAhrsSettings *s = &settings[i];
+        *s = (FusionAhrsSettings){
+                .convention = FusionConventionNwu,
+                .gyroscopeRange = gyro_range,
+                .magneticRejection = 90.0f,
+        };
+        if (random) {
+            s->gain = uniform(&seed, &gain);
+            s->accelerationRejection = uniform(&seed, &rejection);
+            s->recoveryTriggerPeriod = (unsigned)lroundf(uniform(&seed, &period));
+        } else {
+            s->gain = range_value(&gain, i % gain.n);
+            s->accelerationRejection = range_value(&rejection, (i / gain.n) % rejection.n);
+            s->recoveryTriggerPeriod = (unsigned)lroundf(range_value(&period, i / gain.n / rejection.n));
+        }
+    }
+
+    // Tilt threshold pairs, converted to what the firmware compares with
+    size_t pair_count = (size_t)enter.n * exit_frac.n;
+    tilt_pair_t *pairs = calloc(pair_count, sizeof(*pairs));
+    for (size_t p = 0; p < pair_count; p++) {
+        float e = range_value(&enter, p % enter.n);
+        pairs[p].enter = firmware_units(e);
+        pairs[p].exit = firmware_units(e * range_value(&exit_frac, p / enter.n));
+    }
+
+    sweep_t sw = {
+            .instances = instances,
+            .pairs = pairs,
+            .pair_count = pair_count,
+            .state = calloc(instances * pair_count, sizeof(tilt_state_t)),
+            .score = calloc(instances * pair_count, sizeof(score_t)),
+            .err_sq = calloc(instances, sizeof(double)),
+    };
+
+    int sessions = argc - optind;
+    double t0 = (double)clock() / CLOCKS_PER_SEC;
+    struct timespec w0, w1;
+    clock_gettime(CLOCK_MONOTONIC, &w0);
+    size_t samples_total = 0;
+
+    for (int n = 0; n < (sessions ? sessions : 1); n++) {
+        imu_log_t log;
+        const char *path = sessions ? argv[optind + n] : NULL;
+        if (path ? !imu_log_read_csv(path, &log) : !imu_log_synthesize(&log, 60000, 100.0f, seed)) {
+            fprintf(stderr, "cannot load %s\n", path ? path : "synthetic session");
+            return 1;
+        }
+        samples_total += log.count;
+
+        float *roll_ref = log.roll_ref;
+        if (!roll_ref) {
+            roll_ref = malloc(log.count * sizeof(float));
+            reference_from_accelerometer(&log, roll_ref);
+        }
+
+        double *time = malloc(log.count * sizeof(double));
+        double t = 0;
+        sw.settle = log.count;
+        for (size_t i = 0; i < log.count; i++) {
+            t += i ? log.delta_time[i] : 0;
+            time[i] = t;
+            if (sw.settle == log.count && t >= SETTLE_S)
+                sw.settle = i;
+        }
+
+        onset_t *onsets[2];
+        for (int side = 0; side < 2; side++) {
+            onsets[side] = malloc(log.count * sizeof(onset_t));
+            sw.onset_count[side] = find_onsets(roll_ref, log.count, intended, side, onsets[side]);
+            // Crossings during the start-up ramp are not scored
+            size_t skip = 0;
+            while (skip < sw.onset_count[side] && onsets[side][skip].sample < sw.settle)
+                skip++;
+            sw.onsets[side] = onsets[side] + skip;
+            sw.onset_count[side] -= skip;
+        }
+
+        sw.log = &log;
+        sw.roll_ref = roll_ref;
+        sw.time = time;
+        memset(sw.state, 0, instances * pair_count * sizeof(tilt_state_t));
+        memset(sw.err_sq, 0, instances * sizeof(double));
+
+        ahrs_soa_t *soa = ahrs_soa_create(settings, instances);
+        ahrs_soa_update_no_magnetometer(soa, log.gyroscope, log.accelerometer, log.delta_time,
+                                        log.count, threads, observe, &sw);
+        ahrs_soa_free(soa);
+
+        size_t scored = log.count - sw.settle;
+        for (size_t i = 0; i < instances; i++) {
+            for (size_t p = 0; p < pair_count; p++) {
+                tilt_state_t *st = &sw.state[i * pair_count + p];
+                score_t *sc = &sw.score[i * pair_count + p];
+                for (int side = 0; side < 2; side++)
+                    st->misses += sw.onset_count[side] - st->next[side];
+                sc->err_sq += sw.err_sq[i];
+                sc->err_n += scored;
+                sc->latency_sum += st->latency_sum;
+                sc->matched += st->matched;
+                sc->false_triggers += st->false_triggers;
+                sc->misses += st->misses;
+            }
+        }
+
+        printf("%s: %zu samples, %zu/%zu reference tilts left/right%s\n",
+               path ? path : "synthetic", log.count, sw.onset_count[0], sw.onset_count[1],
+               log.roll_ref ? "" : " (reference from accelerometer)");
+
+        if (roll_ref != log.roll_ref)
+            free(roll_ref);
+        free(time);
+        free(onsets[0]);
+        free(onsets[1]);
+        imu_log_free(&log);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &w1);
+    double wall = (w1.tv_sec - w0.tv_sec) + (w1.tv_nsec - w0.tv_nsec) / 1e9;
+    printf("%zu AHRS configurations x %zu threshold pairs, %.1f s (%.0f AHRS updates/s, cpu %.1f s)\n\n",
+           instances, pair_count, wall, instances * (double)samples_total / wall,
+           (double)clock() / CLOCKS_PER_SEC - t0);
+
+    size_t combos = instances * pair_count;
+    size_t *order = malloc(combos * sizeof(size_t));
+    for (size_t i = 0; i < combos; i++)
+        order[i] = i;
+    rank_scores = sw.score;
+    qsort(order, combos, sizeof(size_t), by_score);
+
+    printf("rank  score  gain  rej_deg  period  enter  exit  rms_deg  lat_ms  false  miss\n");
+    for (size_t r = 0; r < top && r < combos; r++) {
+        size_t c = order[r];
+        const FusionAhrsSettings *s = &settings[c / pair_count];
+        const tilt_pair_t *p = &pairs[c % pair_count];
+        const score_t *sc = &sw.score[c];
+        printf("%4zu %6.2f %5.2f %8.1f %7u %6d %5d %8.2f %7.0f %6u %5u\n", r + 1,
+               total_score(sc), s->gain, s->accelerationRejection, s->recoveryTriggerPeriod,
+               p->enter, p->exit, sc->err_n ? sqrt(sc->err_sq / sc->err_n) : 0,
+               sc->matched ? 1000.0 * sc->latency_sum / sc->matched : 0,
+               sc->false_triggers, sc->misses);
+    }
+
+    if (header && combos) {
+        size_t best = order[0];
+        if (!write_header(header, &settings[best / pair_count], &pairs[best % pair_count],
+                          &sw.score[best], argc, argv)) {
+            perror(header);
+            return 1;
+        }
+        printf("\nwrote %s\n", header);
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+// Runs the display service of the firmware (main/display.c, unchanged) on
+// the host: its flush task on the FreeRTOS stand-in in freertos_sim.c, the
+// panel on the SSD1306 emulator with DMA transfers that take the time the
+// 2 MHz SPI would. A status-task stand-in presents frames in a few patterns
+// and the counters behind CODE_STAT_DISPLAY_* (0x26-0x29) are checked
+// against what each pattern must produce:
+//
+//   paced:        10 fps, partial frames       10 fps, nothing refused
+//   jitter:       90/110 ms apart (tick wake)  nothing refused
+//   too fast:     every 20 ms                  10 fps, 4 of 5 rate-limited
+//   during flush: full frames, again 1 ms on   every second present busy
+//   slow render:  5 ms of drawing              every frame over budget, degraded
+//   fast render:  0.5 ms of drawing            back to full frames at once
+//
+// After each pattern the emulated GDDRAM must match the back buffer. Exits
+// non-zero on any mismatch.
+//
+//   display_check
+
+#include "display.h"
+#include "freertos_sim.h"
+#include "ssd1306_emu.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SPI_HZ 2000000 // spi_init() in ssd1306_interface_init
+#define FRAME_BYTES (GFX_MONO_LCD_WIDTH * GFX_MONO_LCD_PAGES)
+// The whole panel: one window command burst and the data, at SPI_HZ
+#define FULL_FLUSH_MIN_US (FRAME_BYTES * 8 / (SPI_HZ / 1000000))
+#define FULL_FLUSH_MAX_US ((FRAME_BYTES + 16) * 8 / (SPI_HZ / 1000000))
+
+static uint32_t failures;
+
+static void expect(const char *pattern, const char *what, uint32_t got, uint32_t lo, uint32_t hi) {
+    if (got < lo || got > hi) {
+        printf("FAIL %s: %s %u, expected ", pattern, what, got);
+        if (lo == hi)
+            printf("%u\n", lo);
+        else
+            printf("%u..%u\n", lo, hi);
+        failures++;
+    }
+}
+
+typedef struct {
+    const char *name;
+    uint32_t seconds;      // long enough for a whole fps window
+    uint32_t period_us[2]; // alternating time between frames
+    uint32_t render_us;    // display_begin_frame() to display_present()
+    uint32_t again_us;     // a second present this long after, 0 for none
+    bool full;             // invert the whole panel instead of one line
+} pattern_t;
+
+typedef struct {
+    uint32_t presents, accepted, reduced;
+} counts_t;
+
+static void draw(ssd1306_t *disp, uint32_t frame, bool full) {
+    if (full) {
+        if (frame & 1)
+            gfx_clear_square(disp, 0, 0, disp->width, disp->height);
+        else
+            gfx_draw_square(disp, 0, 0, disp->width, disp->height);
+        return;
+    }
+    char text[22];
+    snprintf(text, sizeof(text), "Tx %u", frame);
+    gfx_clear_square(disp, 0, 16, disp->width, 8);
+    gfx_draw_string(disp, 0, 16, 1, text);
+}
+
+static counts_t run(const pattern_t *p) {
+    ssd1306_t *disp = display_back_buffer();
+    counts_t c = {0};
+    uint64_t t = freertos_sim_now_us();
+    const uint64_t end = t + p->seconds * 1000000ull;
+
+    for (uint32_t frame = 0; t < end; frame++) {
+        if (!display_begin_frame())
+            c.reduced++;
+        draw(disp, frame, p->full);
+        freertos_sim_run_until(freertos_sim_now_us() + p->render_us);
+        c.presents++;
+        c.accepted += display_present();
+        if (p->again_us) {
+            freertos_sim_run_until(freertos_sim_now_us() + p->again_us);
+            c.presents++;
+            c.accepted += display_present();
+        }
+        t += p->period_us[frame & 1];
+        freertos_sim_run_until(t);
+    }
+    return c;
+}
+
+// Lets the last frame out and sends whatever a refused present left behind
+static void settle(void) {
+    for (int i = 0; i < 3; i++) {
+        freertos_sim_run_until(freertos_sim_now_us() + 1000000 / DISPLAY_MAX_FPS);
+        display_present();
+    }
+    freertos_sim_run_until(freertos_sim_now_us() + 1000000 / DISPLAY_MAX_FPS);
+}
+
+static void check_gddram(const char *pattern) {
+    const ssd1306_t *disp = display_back_buffer();
+    if (memcmp(ssd1306_emu_gddram(), disp->buffer, FRAME_BYTES) != 0) {
+        printf("FAIL %s: GDDRAM differs from the back buffer\n", pattern);
+        failures++;
+    }
+}
+
+static void print_wire(const display_stats_t *s) {
+    // As send_stats() in main.c puts them on the link
+    const uint32_t flush_max = s->flush_us_max > 32767 ? 32767 : s->flush_us_max;
+    printf("  0x26 fps %u  0x27 flush_us %u  0x28 drops %u  0x29 over_budget %u\n",
+           s->fps, flush_max, s->busy + s->limited, s->over_budget);
+}
+
+int main(void) {
+    freertos_sim_init(SPI_HZ);
+    ssd1306_emu_set_deferred_dma(true);
+    if (!display_init()) {
+        printf("FAIL display_init\n");
+        return 1;
+    }
+
+    static const pattern_t patterns[] = {
+            {"paced", 3, {100000, 100000}, 0, 0, false},
+            {"jitter", 3, {90000, 110000}, 0, 0, false},
+            {"too fast", 3, {20000, 20000}, 0, 0, false},
+            {"during flush", 3, {100000, 100000}, 0, 1000, true},
+            {"slow render", 3, {100000, 100000}, 5000, 0, false},
+            {"fast render", 3, {100000, 100000}, 500, 0, false},
+    };
+    const size_t n = sizeof(patterns) / sizeof(patterns[0]);
+
+    for (size_t i = 0; i < n; i++) {
+        const pattern_t *p = &patterns[i];
+        display_stats_t before, after;
+        display_get_stats(&before);
+        const counts_t c = run(p);
+        display_get_stats(&after);
+
+        const uint32_t frames = after.frames - before.frames;
+        const uint32_t busy = after.busy - before.busy;
+        const uint32_t limited = after.limited - before.limited;
+        const uint32_t over = after.over_budget - before.over_budget;
+        printf("%-13s %3u presents: %3u frames, %3u busy, %3u limited, %2u over budget, "
+               "%2u fps, flush %u us (max %u)\n",
+               p->name, c.presents, frames, busy, limited, over, after.fps, after.flush_us,
+               after.flush_us_max);
+        print_wire(&after);
+
+        const uint32_t expected_frames = p->seconds * DISPLAY_MAX_FPS;
+        expect(p->name, "frames", frames, expected_frames, expected_frames);
+        expect(p->name, "accepted presents", c.accepted, frames, frames);
+        expect(p->name, "fps", after.fps, DISPLAY_MAX_FPS, DISPLAY_MAX_FPS);
+        expect(p->name, "busy", busy, p->again_us ? frames : 0, p->again_us ? frames : 0);
+        const uint32_t too_soon = p->again_us ? 0 : c.presents - frames;
+        expect(p->name, "limited", limited, too_soon, too_soon);
+        if (p->render_us > DISPLAY_FRAME_BUDGET_US) {
+            expect(p->name, "over budget", over, frames, frames);
+            expect(p->name, "degraded", after.degraded, 1, 1);
+            expect(p->name, "reduced frames", c.reduced, frames - 1, frames - 1);
+        } else {
+            expect(p->name, "over budget", over, 0, 0);
+            expect(p->name, "degraded", after.degraded, 0, 0);
+            // Only the first frame after a slow stretch is still reduced
+            const uint32_t reduced = i > 0 && patterns[i - 1].render_us > DISPLAY_FRAME_BUDGET_US;
+            expect(p->name, "reduced frames", c.reduced, reduced, reduced);
+        }
+        if (p->full)
+            expect(p->name, "flush_us (full frame)", after.flush_us, FULL_FLUSH_MIN_US, FULL_FLUSH_MAX_US);
+        else
+            expect(p->name, "flush_us (one line)", after.flush_us, 1, FULL_FLUSH_MIN_US / 4);
+
+        settle();
+        check_gddram(p->name);
+    }
+
+    display_stats_t s;
+    display_get_stats(&s);
+    // The first frame sends the whole panel
+    expect("all", "flush_us_max", s.flush_us_max, FULL_FLUSH_MIN_US, FULL_FLUSH_MAX_US);
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+#include "freertos_sim.h"
+#include "ssd1306_emu.h"
+#include "task.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_TASKS 4
+
+struct sim_task {
+    TaskFunction_t code;
+    void *parameters;
+    pthread_t thread;
+    uint32_t notify[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+    int waiting; // notification index the task is blocked on, -1 if ready
+};
+
+// Exactly one thread runs at a time: the caller of freertos_sim_run_until()
+// (running == NULL) or one task
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t turn = PTHREAD_COND_INITIALIZER;
+static struct sim_task *running;
+
+static struct sim_task tasks[MAX_TASKS];
+static int task_count;
+
+static uint64_t now_us;
+static uint32_t spi_hz;
+static uint32_t wire_bytes; // emulator bytes already accounted for
+static uint64_t dma_done_us;
+static bool dma_timed;
+
+void freertos_sim_init(uint32_t hz) {
+    spi_hz = hz;
+}
+
+uint64_t freertos_sim_now_us(void) {
+    return now_us;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)now_us;
+}
+
+// Called with lock held, by the thread that is running
+static void switch_to(struct sim_task *next, struct sim_task *self) {
+    running = next;
+    pthread_cond_broadcast(&turn);
+    while (running != self)
+        pthread_cond_wait(&turn, &lock);
+}
+
+static void *task_main(void *arg) {
+    struct sim_task *t = arg;
+    pthread_mutex_lock(&lock);
+    while (running != t)
+        pthread_cond_wait(&turn, &lock);
+    pthread_mutex_unlock(&lock);
+    t->code(t->parameters);
+    fprintf(stderr, "freertos_sim: a task returned\n");
+    abort();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *created) {
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    if (task_count == MAX_TASKS)
+        return pdFAIL;
+    struct sim_task *t = &tasks[task_count];
+    *t = (struct sim_task){.code = code, .parameters = parameters, .waiting = -1};
+    if (pthread_create(&t->thread, NULL, task_main, t) != 0)
+        return pdFAIL;
+    task_count++;
+    if (created)
+        *created = t;
+    return pdPASS;
+}
+
+static struct sim_task *current_task(void) {
+    if (!running) {
+        fprintf(stderr, "freertos_sim: only tasks may block on a notification\n");
+        abort();
+    }
+    return running;
+}
+
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear, TickType_t wait) {
+    (void)wait; // always portMAX_DELAY in the firmware
+    pthread_mutex_lock(&lock);
+    struct sim_task *t = current_task();
+    if (t->notify[index] == 0) {
+        t->waiting = (int)index;
+        switch_to(NULL, t);
+        t->waiting = -1;
+    }
+    uint32_t value = t->notify[index];
+    t->notify[index] = clear ? 0 : value - 1;
+    pthread_mutex_unlock(&lock);
+    return value;
+}
+
+// Only the running thread touches task state, and every switch between
+// threads goes through the lock
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index) {
+    task->notify[index]++;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveIndexedFromISR(TaskHandle_t task, UBaseType_t index, BaseType_t *woken) {
+    task->notify[index]++;
+    if (woken)
+        *woken = pdTRUE;
+}
+
+static bool ready(const struct sim_task *t) {
+    return t->waiting < 0 || t->notify[t->waiting] > 0;
+}
+
+static uint32_t emu_wire_bytes(void) {
+    ssd1306_emu_stats_t s;
+    ssd1306_emu_get_stats(&s);
+    return s.cmd_bytes + s.data_bytes;
+}
+
+void freertos_sim_run_until(uint64_t t_us) {
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        // Writes outside a DMA transfer (ssd1306_init) are not timed
+        if (!ssd1306_emu_dma_pending())
+            wire_bytes = emu_wire_bytes();
+
+        struct sim_task *next = NULL;
+        for (int i = 0; i < task_count && !next; i++)
+            if (ready(&tasks[i]))
+                next = &tasks[i];
+        if (next) {
+            switch_to(next, NULL);
+            continue;
+        }
+
+        if (!ssd1306_emu_dma_pending())
+            break;
+        if (!dma_timed) {
+            // Everything sent since the last completion, commands included,
+            // goes out at the SPI clock from now
+            const uint32_t bytes = emu_wire_bytes();
+            dma_done_us = now_us + ((uint64_t)(bytes - wire_bytes) * 8 * 1000000 + spi_hz - 1) / spi_hz;
+            wire_bytes = bytes;
+            dma_timed = true;
+        }
+        if (dma_done_us > t_us)
+            break;
+        now_us = dma_done_us;
+        dma_timed = false;
+        ssd1306_emu_dma_complete();
+    }
+    if (t_us > now_us)
+        now_us = t_us;
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,27 @@
+#ifndef FREERTOS_SIM_H
+#define FREERTOS_SIM_H
+
+#include <stdint.h>
+
+// Runs firmware code that uses FreeRTOS tasks and notifications on the host,
+// on a virtual microsecond clock. The calling thread stands for the highest
+// priority task: it runs until it blocks in freertos_sim_run_until(), and
+// only then do the tasks created with xTaskCreate() (each on its own thread,
+// one at a time) get to run, in zero virtual time. Only the functions in
+// freertos_sim/task.h are provided.
+//
+// SPI transfers to the SSD1306 emulator take virtual time: with deferred DMA
+// on (ssd1306_emu_set_deferred_dma), a queued transfer completes, and its
+// callback runs as if from the DMA interrupt, once every byte sent since the
+// previous completion has been clocked out at spi_hz.
+
+void freertos_sim_init(uint32_t spi_hz);
+
+// Virtual time, in us
+uint64_t freertos_sim_now_us(void);
+
+// Blocks the caller until the given time, running the other tasks and the
+// DMA completions that fall before it
+void freertos_sim_run_until(uint64_t t_us);
+
+#endif // FREERTOS_SIM_H
@@ -0,0 +1,23 @@
+#ifndef FREERTOS_SIM_FREERTOS_H
+#define FREERTOS_SIM_FREERTOS_H
+
+// Just enough of FreeRTOS for main/display.c on the host; see
+// host/freertos_sim.h. The configuration is the firmware's.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOSConfig.h"
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+#endif // FREERTOS_SIM_FREERTOS_H
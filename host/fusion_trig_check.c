@@ -0,0 +1,203 @@
+// Compares FusionFastAtan2 and FusionFastAsin (FUSION_USE_FAST_TRIG) with
+// libm over their whole input domain and prints the maximum error and the
+// speed of both, plus FusionQuaternionToEuler built either way. Exits with 1
+// if an error is over the bound documented in FusionMath.h, or if
+// FusionFastAsin is not odd or not 0 at 0.
+//
+//   fusion_trig_check [-s stride] [-n calls]
+//
+// atan2 is swept over the float ratios in 0 to 1 (which is all the
+// polynomial sees) in each of the four quadrants, asin over the floats in
+// -1 to 1, taking every stride-th float (default 64; -s 1 is exhaustive and
+// takes several minutes).
+
+#include "FusionMath.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Maximum errors documented in FusionMath.h, radians
+#define ATAN2_MAX_ERROR 2e-6
+#define ASIN_MAX_ERROR 3e-7
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Steps through non-negative floats in order of their bit patterns
+static float next_float(float x, unsigned stride) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits += stride;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+typedef struct {
+    double max;
+    float at;
+} error_t;
+
+static void track(error_t *e, double error, float at) {
+    error = fabs(error);
+    if (error > e->max) {
+        e->max = error;
+        e->at = at;
+    }
+}
+
+// Euler angles exactly as FusionQuaternionToEuler, with either function set
+static FusionEuler euler_libm(const FusionQuaternion quaternion) {
+#define Q quaternion.element
+    const float halfMinusQySquared = 0.5f - Q.y * Q.y;
+    const FusionEuler euler = {.angle = {
+            .roll = FusionRadiansToDegrees(atan2f(Q.w * Q.x + Q.y * Q.z, halfMinusQySquared - Q.x * Q.x)),
+            .pitch = FusionRadiansToDegrees(asinf(fminf(fmaxf(2.0f * (Q.w * Q.y - Q.z * Q.x), -1.0f), 1.0f))),
+            .yaw = FusionRadiansToDegrees(atan2f(Q.w * Q.z + Q.x * Q.y, halfMinusQySquared - Q.z * Q.z)),
+    }};
+    return euler;
+#undef Q
+}
+
+static FusionEuler euler_fast(const FusionQuaternion quaternion) {
+#define Q quaternion.element
+    const float halfMinusQySquared = 0.5f - Q.y * Q.y;
+    const FusionEuler euler = {.angle = {
+            .roll = FusionRadiansToDegrees(FusionFastAtan2(Q.w * Q.x + Q.y * Q.z, halfMinusQySquared - Q.x * Q.x)),
+            .pitch = FusionRadiansToDegrees(FusionFastAsin(2.0f * (Q.w * Q.y - Q.z * Q.x))),
+            .yaw = FusionRadiansToDegrees(FusionFastAtan2(Q.w * Q.z + Q.x * Q.y, halfMinusQySquared - Q.z * Q.z)),
+    }};
+    return euler;
+#undef Q
+}
+
+static float euler_sum_libm(const FusionQuaternion q) {
+    const FusionEuler e = euler_libm(q);
+    return e.angle.roll + e.angle.pitch + e.angle.yaw;
+}
+
+static float euler_sum_fast(const FusionQuaternion q) {
+    const FusionEuler e = euler_fast(q);
+    return e.angle.roll + e.angle.pitch + e.angle.yaw;
+}
+
+static float random_float(unsigned *state) {
+    *state = *state * 1103515245u + 12345u;
+    return ((*state >> 8) & 0xFFFFFF) / (float)0x800000 - 1.0f; // -1 to 1
+}
+
+int main(int argc, char **argv) {
+    unsigned stride = 64;
+    size_t calls = 10000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+        switch (opt) {
+        case 's': stride = strtoul(optarg, NULL, 0); break;
+        case 'n': calls = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-s stride] [-n calls]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (stride == 0)
+        stride = 1;
+
+    // atan2: ratio r in 0 to 1 as (r, 1) and (1, r), all four sign pairs
+    error_t atan2_error = {0};
+    for (float r = 0.0f; r <= 1.0f; r = next_float(r, stride)) {
+        for (int quadrant = 0; quadrant < 4; quadrant++) {
+            const float sy = quadrant & 1 ? -1.0f : 1.0f, sx = quadrant & 2 ? -1.0f : 1.0f;
+            if ((r != 0.0f) || (sy > 0.0f)) // y = -0 is documented as +0
+                track(&atan2_error, FusionFastAtan2(sy * r, sx) - atan2((double)(sy * r), sx), r);
+            track(&atan2_error, FusionFastAtan2(sy, sx * r) - atan2(sy, (double)(sx * r)), r);
+        }
+    }
+    track(&atan2_error, FusionFastAtan2(0.0f, 0.0f) - atan2f(0.0f, 0.0f), 0.0f);
+    track(&atan2_error, FusionFastAtan2(0.0f, -1.0f) - atan2f(0.0f, -1.0f), 0.0f);
+
+    error_t asin_error = {0};
+    unsigned asin_not_odd = 0;
+    for (float v = 0.0f; v <= 1.0f; v = next_float(v, stride)) {
+        track(&asin_error, FusionFastAsin(v) - asin((double)v), v);
+        track(&asin_error, FusionFastAsin(-v) - asin((double)-v), -v);
+        if (FusionFastAsin(-v) != -FusionFastAsin(v))
+            asin_not_odd++;
+    }
+
+    printf("FusionFastAtan2: max error %.3g rad (%.3g deg) at ratio %.9g\n",
+           atan2_error.max, FusionRadiansToDegrees((float)atan2_error.max), atan2_error.at);
+    printf("FusionFastAsin:  max error %.3g rad (%.3g deg) at %.9g\n",
+           asin_error.max, FusionRadiansToDegrees((float)asin_error.max), asin_error.at);
+
+    int failures = 0;
+    if (atan2_error.max > ATAN2_MAX_ERROR) {
+        printf("FAIL FusionFastAtan2 error over %g rad\n", ATAN2_MAX_ERROR);
+        failures++;
+    }
+    if (asin_error.max > ASIN_MAX_ERROR) {
+        printf("FAIL FusionFastAsin error over %g rad\n", ASIN_MAX_ERROR);
+        failures++;
+    }
+    if (FusionFastAsin(0.0f) != 0.0f) {
+        printf("FAIL FusionFastAsin(0) = %g\n", FusionFastAsin(0.0f));
+        failures++;
+    }
+    if (asin_not_odd) {
+        printf("FAIL FusionFastAsin(-x) != -FusionFastAsin(x) for %u values\n", asin_not_odd);
+        failures++;
+    }
+
+    // Speed, over random unit quaternions
+    FusionQuaternion *q = malloc(calls * sizeof(*q));
+    unsigned seed = 1;
+    for (size_t i = 0; i < calls; i++) {
+        FusionQuaternion r = {.element = {random_float(&seed), random_float(&seed),
+                                          random_float(&seed), random_float(&seed)}};
+        q[i] = FusionQuaternionNormalise(r);
+    }
+
+    volatile float sink;
+    float sum;
+    double t0;
+
+#define TIME(label, expression)                                           \
+    do {                                                                  \
+        sum = 0.0f;                                                       \
+        t0 = now_s();                                                     \
+        for (size_t i = 0; i < calls; i++)                                \
+            sum += (expression);                                          \
+        sink = sum;                                                       \
+        printf("%-18s %6.1f ns/call\n", label, (now_s() - t0) * 1e9 / calls); \
+    } while (0)
+
+    printf("\n");
+    TIME("atan2f", atan2f(q[i].element.x, q[i].element.w));
+    TIME("FusionFastAtan2", FusionFastAtan2(q[i].element.x, q[i].element.w));
+    TIME("asinf", asinf(q[i].element.x));
+    TIME("FusionFastAsin", FusionFastAsin(q[i].element.x));
+    TIME("euler (libm)", euler_sum_libm(q[i]));
+    TIME("euler (fast)", euler_sum_fast(q[i]));
+    (void)sink;
+
+    double euler_error = 0;
+    for (size_t i = 0; i < calls; i++) {
+        const FusionEuler a = euler_libm(q[i]), b = euler_fast(q[i]);
+        for (int axis = 0; axis < 3; axis++) {
+            double d = fabs(a.array[axis] - b.array[axis]);
+            if (d > 180.0)
+                d = 360.0 - d; // +-180 wrap
+            if (d > euler_error)
+                euler_error = d;
+        }
+    }
+    printf("\nFusionQuaternionToEuler: max difference %.3g deg\n", euler_error);
+    free(q);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,346 @@
+// Runs the gesture recognizer of mpu6050_task (main/gesture.c) over IMU
+// logs, through FusionAhrs with the firmware settings, and checks that it
+// finds the expected gestures and nothing else.
+//
+//   gesture_check [-w prefix] [-n repeats]
+//   gesture_check [-e shake,punch,...] session.csv...
+//
+// Without session files it replays a set of synthetic recordings (still,
+// slow and quick tilts, shakes on two axes, punches, a flick and a
+// sequence), each with its expected gestures, and exits non-zero if any
+// differs; -w also writes them as CSV so they can be replayed on the other
+// tools. With session files it prints the gestures found in each, and with
+// -e compares them to the expected sequence. The time per sample of
+// gesture_update is printed in both modes.
+
+#include "imu_log.h"
+#include "gesture.h"
+#include "ahrs_tuning.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RATE_HZ 100.0f // IMU_SAMPLE_RATE
+#define MAX_GESTURES 16
+
+static const char *const names[] = {
+        [GESTURE_NONE] = "none",
+        [GESTURE_SHAKE] = "shake",
+        [GESTURE_PUNCH] = "punch",
+        [GESTURE_FLICK] = "flick",
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic recordings
+
+typedef enum { STILL, TILT, SHAKE, IMPULSE } segment_kind_t;
+
+typedef struct {
+    segment_kind_t kind;
+    float duration; // s; IMPULSE: push time (braking lasts 1.2x as long)
+    FusionVector axis; // SHAKE, IMPULSE: direction in the controller frame
+    float amplitude;   // g, or degrees for TILT
+    float frequency;   // Hz; IMPULSE: braking peak in g
+} segment_t;
+
+typedef struct {
+    const char *name;
+    segment_t segments[8];
+    gesture_t expected[MAX_GESTURES];
+} scenario_t;
+
+// One segment each
+#define STILL_FOR(seconds) {.kind = STILL, .duration = (seconds)}
+#define TILT_FOR(seconds, degrees, hz) \
+    {.kind = TILT, .duration = (seconds), .amplitude = (degrees), .frequency = (hz)}
+#define SHAKE_ALONG(seconds, x, y, z, g, hz) \
+    {.kind = SHAKE, .duration = (seconds), .axis = {.axis = {x, y, z}}, .amplitude = (g), .frequency = (hz)}
+#define IMPULSE_ALONG(seconds, x, y, z, g, brake_g) \
+    {.kind = IMPULSE, .duration = (seconds), .axis = {.axis = {x, y, z}}, .amplitude = (g), .frequency = (brake_g)}
+// Long enough for the AHRS initialisation to finish
+#define SETTLE STILL_FOR(4.0f)
+
+static const scenario_t scenarios[] = {
+        {"still", {SETTLE, STILL_FOR(4.0f)}, {GESTURE_NONE}},
+        {"slow tilts", {SETTLE, TILT_FOR(6.0f, 35.0f, 0.5f), STILL_FOR(1.0f)}, {GESTURE_NONE}},
+        {"quick tilts", {SETTLE, TILT_FOR(3.0f, 45.0f, 1.5f), STILL_FOR(1.0f)}, {GESTURE_NONE}},
+        {"gentle shake", {SETTLE, SHAKE_ALONG(1.0f, 1, 0, 0, 0.8f, 5.0f), STILL_FOR(1.0f)}, {GESTURE_NONE}},
+        {"shake x", {SETTLE, SHAKE_ALONG(1.0f, 1, 0, 0, 2.0f, 5.0f), STILL_FOR(1.0f)}, {GESTURE_SHAKE}},
+        {"shake z", {SETTLE, SHAKE_ALONG(0.8f, 0, 0, 1, 1.8f, 4.0f), STILL_FOR(1.0f)}, {GESTURE_SHAKE}},
+        {"punch x", {SETTLE, IMPULSE_ALONG(0.10f, 1, 0, 0, 2.5f, 2.0f), STILL_FOR(1.0f)}, {GESTURE_PUNCH}},
+        {"punch y", {SETTLE, IMPULSE_ALONG(0.12f, 0, -1, 0, 2.2f, 1.8f), STILL_FOR(1.0f)}, {GESTURE_PUNCH}},
+        {"flick", {SETTLE, IMPULSE_ALONG(0.06f, 0, 0, 1, 2.0f, 1.5f), STILL_FOR(1.0f)}, {GESTURE_FLICK}},
+        {"sequence",
+         {SETTLE,
+          IMPULSE_ALONG(0.10f, 0.7f, 0.7f, 0, 2.5f, 2.0f), STILL_FOR(1.0f),
+          IMPULSE_ALONG(0.06f, 0, 0, -1, 2.0f, 1.5f), STILL_FOR(1.0f),
+          SHAKE_ALONG(1.2f, 0, 1, 0, 2.0f, 4.0f), STILL_FOR(1.0f)},
+         {GESTURE_PUNCH, GESTURE_FLICK, GESTURE_SHAKE}},
+};
+
+static float gaussian(unsigned *state) {
+    float u = 0;
+    for (int i = 0; i < 4; i++) {
+        *state = *state * 1103515245u + 12345u;
+        u += (float)((*state >> 8) & 0xFFFF) / 65536.0f;
+    }
+    return (u - 2.0f) * 1.732f; // unit variance
+}
+
+static size_t segment_samples(const segment_t *s) {
+    float duration = s->kind == IMPULSE ? s->duration * 2.2f : s->duration;
+    return (size_t)lroundf(duration * RATE_HZ);
+}
+
+// The controller level (roll only, for TILT) with linear acceleration on
+// top, plus sensor noise
+static bool synthesize(const scenario_t *sc, imu_log_t *log, unsigned seed) {
+    size_t count = 0;
+    for (const segment_t *s = sc->segments; s->duration > 0; s++)
+        count += segment_samples(s);
+
+    *log = (imu_log_t){0};
+    log->gyroscope = malloc(count * sizeof(*log->gyroscope));
+    log->accelerometer = malloc(count * sizeof(*log->accelerometer));
+    log->delta_time = malloc(count * sizeof(*log->delta_time));
+    if (!log->gyroscope || !log->accelerometer || !log->delta_time) {
+        imu_log_free(log);
+        return false;
+    }
+    log->count = count;
+
+    const float dt = 1.0f / RATE_HZ;
+    size_t i = 0;
+    for (const segment_t *s = sc->segments; s->duration > 0; s++) {
+        const size_t n = segment_samples(s);
+        for (size_t k = 0; k < n; k++, i++) {
+            const float t = k * dt;
+            float roll = 0, roll_rate = 0, a = 0;
+            switch (s->kind) {
+            case STILL:
+                break;
+            case TILT: {
+                const float w = 2.0f * (float)M_PI * s->frequency;
+                roll = s->amplitude * sinf(w * t);
+                roll_rate = s->amplitude * w * cosf(w * t);
+                break;
+            }
+            case SHAKE:
+                a = s->amplitude * sinf(2.0f * (float)M_PI * s->frequency * t);
+                break;
+            case IMPULSE: {
+                // Half-sine push, then a longer, weaker half-sine of braking
+                const float push = s->duration, brake = s->duration * 1.2f;
+                if (t < push)
+                    a = s->amplitude * sinf((float)M_PI * t / push);
+                else
+                    a = -s->frequency * sinf((float)M_PI * (t - push) / brake);
+                break;
+            }
+            }
+            const float r = FusionDegreesToRadians(roll);
+            const FusionVector linear = FusionVectorMultiplyScalar(s->axis, a);
+            log->gyroscope[i] = (FusionVector){.axis = {
+                    roll_rate + gaussian(&seed) * 0.3f,
+                    gaussian(&seed) * 0.3f,
+                    gaussian(&seed) * 0.3f,
+            }};
+            log->accelerometer[i] = (FusionVector){.axis = {
+                    linear.axis.x + gaussian(&seed) * 0.01f,
+                    sinf(r) + linear.axis.y + gaussian(&seed) * 0.01f,
+                    cosf(r) + linear.axis.z + gaussian(&seed) * 0.01f,
+            }};
+            log->delta_time[i] = dt;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+
+typedef struct {
+    gesture_t found[MAX_GESTURES];
+    float time[MAX_GESTURES];
+    int count;
+    double update_s; // in gesture_update
+} result_t;
+
+static void replay(const imu_log_t *log, result_t *result) {
+    FusionAhrs ahrs;
+    FusionAhrsInitialise(&ahrs);
+    const FusionAhrsSettings settings = {
+            .convention = FusionConventionNwu,
+            .gain = AHRS_TUNING_GAIN,
+            .gyroscopeRange = 1000.0f,
+            .accelerationRejection = AHRS_TUNING_ACCELERATION_REJECTION,
+            .magneticRejection = 90.0f,
+            .recoveryTriggerPeriod = AHRS_TUNING_RECOVERY_TRIGGER_PERIOD,
+    };
+    FusionAhrsSetSettings(&ahrs, &settings);
+
+    gesture_engine_t engine;
+    gesture_init(&engine);
+    *result = (result_t){0};
+
+    float t = 0;
+    for (size_t i = 0; i < log->count; i++) {
+        t += log->delta_time[i];
+        FusionAhrsUpdateNoMagnetometer(&ahrs, log->gyroscope[i], log->accelerometer[i], log->delta_time[i]);
+        const FusionVector linear = FusionAhrsGetLinearAcceleration(&ahrs);
+        const FusionVector earth = FusionAhrsGetEarthAcceleration(&ahrs);
+
+        const double start = now_s();
+        const gesture_t g = gesture_update(&engine, linear, earth);
+        result->update_s += now_s() - start;
+
+        if (g != GESTURE_NONE && result->count < MAX_GESTURES) {
+            result->found[result->count] = g;
+            result->time[result->count] = t;
+            result->count++;
+        }
+    }
+}
+
+static void print_found(const result_t *r) {
+    if (r->count == 0)
+        printf(" -");
+    for (int i = 0; i < r->count; i++)
+        printf(" %s@%.2fs", names[r->found[i]], r->time[i]);
+}
+
+static bool matches(const result_t *r, const gesture_t *expected) {
+    int n = 0;
+    while (n < MAX_GESTURES && expected[n] != GESTURE_NONE)
+        n++;
+    if (n != r->count)
+        return false;
+    for (int i = 0; i < n; i++)
+        if (r->found[i] != expected[i])
+            return false;
+    return true;
+}
+
+// Comma-separated gesture names
+static bool parse_expected(const char *s, gesture_t *expected) {
+    memset(expected, 0, MAX_GESTURES * sizeof(*expected));
+    int n = 0;
+    while (*s) {
+        size_t len = strcspn(s, ",");
+        gesture_t g = GESTURE_NONE;
+        for (int k = GESTURE_SHAKE; k <= GESTURE_FLICK; k++)
+            if (strlen(names[k]) == len && strncmp(s, names[k], len) == 0)
+                g = (gesture_t)k;
+        if (g == GESTURE_NONE || n == MAX_GESTURES - 1)
+            return false;
+        expected[n++] = g;
+        s += len;
+        if (*s == ',')
+            s++;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *write_prefix = NULL;
+    const char *expected_arg = NULL;
+    int repeats = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:n:e:")) != -1) {
+        switch (opt) {
+        case 'w':
+            write_prefix = optarg;
+            break;
+        case 'n':
+            repeats = atoi(optarg);
+            break;
+        case 'e':
+            expected_arg = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-w prefix] [-n repeats] [-e shake,punch,...] [session.csv...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    gesture_t expected[MAX_GESTURES] = {GESTURE_NONE};
+    if (expected_arg && !parse_expected(expected_arg, expected)) {
+        fprintf(stderr, "bad -e list: %s\n", expected_arg);
+        return 2;
+    }
+
+    int failures = 0;
+    double update_s = 0;
+    size_t samples = 0;
+
+    if (optind < argc) {
+        for (int a = optind; a < argc; a++) {
+            imu_log_t log;
+            if (!imu_log_read_csv(argv[a], &log)) {
+                fprintf(stderr, "cannot read %s\n", argv[a]);
+                return 1;
+            }
+            result_t r;
+            replay(&log, &r);
+            update_s += r.update_s;
+            samples += log.count;
+            bool ok = !expected_arg || matches(&r, expected);
+            printf("%-24s", argv[a]);
+            print_found(&r);
+            printf("%s\n", expected_arg ? (ok ? "  ok" : "  MISMATCH") : "");
+            failures += !ok;
+            imu_log_free(&log);
+        }
+    } else {
+        const size_t n = sizeof(scenarios) / sizeof(scenarios[0]);
+        for (size_t s = 0; s < n; s++) {
+            const scenario_t *sc = &scenarios[s];
+            int bad = 0;
+            result_t r;
+            // Repeats differ only in the sensor noise
+            for (int k = 0; k < repeats; k++) {
+                imu_log_t log;
+                if (!synthesize(sc, &log, 1234u + 7919u * k)) {
+                    fprintf(stderr, "out of memory\n");
+                    return 1;
+                }
+                replay(&log, &r);
+                update_s += r.update_s;
+                samples += log.count;
+                if (!matches(&r, sc->expected)) {
+                    if (bad++ == 0) {
+                        printf("  %s, noise seed %d:", sc->name, k);
+                        print_found(&r);
+                        printf("\n");
+                    }
+                }
+                if (write_prefix && k == 0) {
+                    char path[512];
+                    snprintf(path, sizeof(path), "%s%02zu.csv", write_prefix, s);
+                    if (!imu_log_write_csv(path, &log))
+                        fprintf(stderr, "cannot write %s\n", path);
+                }
+                imu_log_free(&log);
+            }
+            printf("%-14s", sc->name);
+            print_found(&r);
+            printf("  %d/%d %s\n", repeats - bad, repeats, bad ? "FAIL" : "ok");
+            failures += bad;
+        }
+    }
+
+    printf("gesture_update: %.1f ns per sample over %zu samples\n",
+           samples ? update_s * 1e9 / samples : 0.0, samples);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,414 @@
+// Golden-image test and benchmark of the gfx rasterizers (lines, filled
+// and empty rectangles, glyphs, column blits) on the SSD1306 emulator.
+//
+//   gfx_check [-g golden_dir] [-u] [-n iterations]
+//
+// Each scene is drawn with oled1_lib, shown through the emulator and the
+// visible image compared with <golden_dir>/<scene>.pbm. Fills, glyphs and
+// blits are also redrawn with the per-pixel routines gfx used before and
+// must give the same framebuffer bytes; lines, which changed from a float
+// DDA to Bresenham, are checked for properties instead: endpoints drawn,
+// one pixel per step of the major axis, every pixel within half a pixel
+// of the ideal segment and the same pixels in both directions. -u rewrites
+// the goldens (after those checks pass). The benchmark times each
+// primitive against its per-pixel version.
+
+#include "gfx.h"
+#include "ssd1306_emu.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef GFX_GOLDEN_DIR
+#define GFX_GOLDEN_DIR "golden"
+#endif
+
+// Defined in font.h, which gfx.c includes
+extern const uint8_t font_8x5[];
+
+#define W GFX_MONO_LCD_WIDTH
+#define H GFX_MONO_LCD_HEIGHT
+#define BUFSIZE (W * H / 8)
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------------
+// Per-pixel reference: the routines gfx used before the byte-wise paths
+
+static void ref_pixel(uint8_t *buf, int32_t x, int32_t y) {
+    if (x < 0 || y < 0 || x >= W || y >= H)
+        return;
+    buf[x + W * (y >> 3)] |= 1 << (y & 7);
+}
+
+static void ref_clear_pixel(uint8_t *buf, int32_t x, int32_t y) {
+    if (x < 0 || y < 0 || x >= W || y >= H)
+        return;
+    buf[x + W * (y >> 3)] &= ~(1 << (y & 7));
+}
+
+static void ref_square(uint8_t *buf, uint32_t x, uint32_t y, uint32_t w, uint32_t h, bool set) {
+    for (uint32_t i = 0; i < w; i++)
+        for (uint32_t j = 0; j < h; j++)
+            (set ? ref_pixel : ref_clear_pixel)(buf, x + i, y + j);
+}
+
+static void ref_char(uint8_t *buf, uint32_t x, uint32_t y, uint32_t scale, char c) {
+    const uint8_t *font = font_8x5;
+    if (c < font[3] || c > font[4])
+        return;
+    uint32_t parts = (font[0] >> 3) + ((font[0] & 7) > 0);
+    for (uint8_t w = 0; w < font[1]; w++) {
+        uint32_t pp = (c - font[3]) * font[1] * parts + w * parts + 5;
+        for (uint32_t lp = 0; lp < parts; lp++, pp++) {
+            uint8_t line = font[pp];
+            for (int j = 0; j < 8; j++, line >>= 1)
+                if (line & 1)
+                    ref_square(buf, x + w * scale, y + ((lp << 3) + j) * scale, scale, scale, true);
+        }
+    }
+}
+
+static void ref_string(uint8_t *buf, uint32_t x, uint32_t y, uint32_t scale, const char *s) {
+    for (; *s; x += (font_8x5[1] + font_8x5[2]) * scale)
+        ref_char(buf, x, y, scale, *s++);
+}
+
+static void ref_blit(uint8_t *buf, uint32_t x, uint32_t y, const uint8_t *data,
+                     uint32_t width, uint32_t pages) {
+    for (uint32_t page = 0; page < pages; page++)
+        for (uint32_t col = 0; col < width; col++)
+            for (int j = 0; j < 8; j++)
+                if (data[page * width + col] & (1 << j))
+                    ref_pixel(buf, x + col, y + page * 8 + j);
+}
+
+static bool buf_pixel(const uint8_t *buf, int32_t x, int32_t y) {
+    return buf[x + W * (y >> 3)] & (1 << (y & 7));
+}
+
+// ---------------------------------------------------------------------------
+// Scenes
+
+static const uint8_t blit_pattern[2 * 12] = {
+        0xFF, 0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81, 0xFF, 0x55, 0xAA,
+        0x0F, 0xF0, 0x3C, 0xC3, 0x01, 0x80, 0x7E, 0x00, 0xFF, 0x11, 0x88, 0x99,
+};
+
+static void scene_lines(ssd1306_t *p, uint8_t *ref) {
+    (void)ref;
+    for (int i = 0; i < 32; i++) {
+        int32_t x = i < 16 ? i * 8 : 127 - (i - 16) * 8;
+        int32_t y = i < 16 ? 0 : 31;
+        gfx_draw_line(p, 64, 16, x, y);
+    }
+    gfx_draw_line(p, -20, 5, 30, 25);   // clipped at the left
+    gfx_draw_line(p, 100, -10, 127, 31); // clipped at the top
+    gfx_draw_line(p, 0, 16, 127, 16);
+    gfx_draw_line(p, 3, 31, 3, 0);
+}
+
+static void scene_rects(ssd1306_t *p, uint8_t *ref) {
+    static const uint32_t r[][4] = {
+            {2, 1, 10, 5}, {14, 3, 9, 13}, {25, 7, 6, 18}, {33, 0, 20, 32},
+            {56, 9, 1, 1}, {58, 9, 7, 22}, {70, 30, 40, 10}, {120, 4, 20, 6},
+    };
+    for (size_t i = 0; i < sizeof(r) / sizeof(r[0]); i++) {
+        gfx_draw_square(p, r[i][0], r[i][1], r[i][2], r[i][3]);
+        ref_square(ref, r[i][0], r[i][1], r[i][2], r[i][3], true);
+    }
+    gfx_clear_square(p, 36, 5, 14, 19);
+    ref_square(ref, 36, 5, 14, 19, false);
+    gfx_draw_empty_square(p, 80, 2, 30, 20);
+    ref_square(ref, 80, 2, 31, 1, true);
+    ref_square(ref, 80, 22, 31, 1, true);
+    ref_square(ref, 80, 2, 1, 21, true);
+    ref_square(ref, 110, 2, 1, 21, true);
+}
+
+static void scene_text(ssd1306_t *p, uint8_t *ref) {
+    static const struct {
+        uint32_t x, y, scale;
+        const char *s;
+    } t[] = {
+            {0, 0, 1, "ABC xyz 0123"},
+            {0, 11, 1, "!#%&()*+,-./"},
+            {76, 3, 1, "@[]^_{}"},
+            {0, 21, 1, "offset 21"},
+            {64, 13, 2, "42"},
+            {96, 9, 3, "W"},
+            {118, 20, 2, "Qz"}, // runs off the right and bottom edges
+    };
+    for (size_t i = 0; i < sizeof(t) / sizeof(t[0]); i++) {
+        gfx_draw_string(p, t[i].x, t[i].y, t[i].scale, t[i].s);
+        ref_string(ref, t[i].x, t[i].y, t[i].scale, t[i].s);
+    }
+}
+
+static void scene_blit(ssd1306_t *p, uint8_t *ref) {
+    static const uint32_t at[][2] = {{0, 0}, {14, 3}, {28, 8}, {42, 13}, {56, 17}, {70, 24}, {120, 5}};
+    for (size_t i = 0; i < sizeof(at) / sizeof(at[0]); i++) {
+        gfx_blit_columns(p, at[i][0], at[i][1], blit_pattern, 12, 2);
+        ref_blit(ref, at[i][0], at[i][1], blit_pattern, 12, 2);
+    }
+}
+
+typedef struct {
+    const char *name;
+    void (*draw)(ssd1306_t *p, uint8_t *ref);
+    bool has_reference;
+} scene_t;
+
+static const scene_t scenes[] = {
+        {"lines", scene_lines, false},
+        {"rects", scene_rects, true},
+        {"text", scene_text, true},
+        {"blit", scene_blit, true},
+};
+
+// ---------------------------------------------------------------------------
+// Line properties
+
+static int check_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    uint8_t forward[BUFSIZE];
+    int errors = 0;
+
+    gfx_clear_buffer(p);
+    gfx_draw_line(p, x1, y1, x2, y2);
+    memcpy(forward, p->buffer, BUFSIZE);
+    gfx_clear_buffer(p);
+    gfx_draw_line(p, x2, y2, x1, y1);
+    if (memcmp(forward, p->buffer, BUFSIZE) != 0)
+        errors++;
+
+    const int32_t dx = abs(x2 - x1), dy = abs(y2 - y1);
+    const int32_t steps = dx > dy ? dx : dy;
+    if (!buf_pixel(forward, x1, y1) || !buf_pixel(forward, x2, y2))
+        errors++;
+
+    int32_t count = 0;
+    for (int32_t y = 0; y < H; y++) {
+        for (int32_t x = 0; x < W; x++) {
+            if (!buf_pixel(forward, x, y))
+                continue;
+            count++;
+            // Distance along the minor axis to the ideal line
+            double t = steps == 0 ? 0 : dx >= dy ? (double)(x - x1) / (x2 - x1) : (double)(y - y1) / (y2 - y1);
+            double ix = x1 + t * (x2 - x1), iy = y1 + t * (y2 - y1);
+            if (t < -1e-9 || t > 1 + 1e-9 || fabs(x - ix) > 0.5 + 1e-9 || fabs(y - iy) > 0.5 + 1e-9)
+                errors++;
+        }
+    }
+    if (count != steps + 1)
+        errors++;
+    return errors;
+}
+
+// ---------------------------------------------------------------------------
+// Goldens
+
+static bool read_pbm(const char *path, uint8_t *bits, size_t size) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    unsigned w, h;
+    bool ok = fscanf(f, "P4 %u %u", &w, &h) == 2 && w == W && h == H && fgetc(f) != EOF &&
+              fread(bits, 1, size, f) == size;
+    fclose(f);
+    return ok;
+}
+
+// Visible emulator image packed like a P4 PBM row
+static void emu_image(uint8_t *bits) {
+    for (uint32_t y = 0; y < H; y++)
+        for (uint32_t x = 0; x < W; x += 8) {
+            uint8_t b = 0;
+            for (uint32_t i = 0; i < 8; i++)
+                b |= ssd1306_emu_pixel(x + i, y) << (7 - i);
+            bits[y * (W / 8) + x / 8] = b;
+        }
+}
+
+static int diff_pixels(const uint8_t *a, const uint8_t *b) {
+    int n = 0;
+    for (size_t i = 0; i < BUFSIZE; i++)
+        n += __builtin_popcount(a[i] ^ b[i]);
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+
+typedef struct {
+    int32_t x1, y1, x2, y2;
+} seg_t;
+
+static seg_t random_seg(unsigned *state) {
+    seg_t s;
+    int32_t *v = &s.x1;
+    for (int i = 0; i < 4; i++) {
+        *state = *state * 1103515245u + 12345u;
+        v[i] = (int32_t)((*state >> 8) % (i & 1 ? H : W));
+    }
+    return s;
+}
+
+// Float DDA of the original gfx_draw_line
+static void ref_line(uint8_t *buf, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    if (x1 > x2) {
+        int32_t t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+    }
+    if (x1 == x2) {
+        if (y1 > y2) {
+            int32_t t = y1; y1 = y2; y2 = t;
+        }
+        for (int32_t i = y1; i <= y2; i++)
+            ref_pixel(buf, x1, i);
+        return;
+    }
+    float m = (float)(y2 - y1) / (float)(x2 - x1);
+    for (int32_t i = x1; i <= x2; i++)
+        ref_pixel(buf, i, (int32_t)(m * (float)(i - x1) + (float)y1));
+}
+
+static volatile uint8_t sink;
+
+static void bench(ssd1306_t *p, int iterations) {
+    enum { SEGS = 256 };
+    seg_t segs[SEGS];
+    unsigned state = 7;
+    for (int i = 0; i < SEGS; i++)
+        segs[i] = random_seg(&state);
+    uint8_t ref[BUFSIZE];
+
+    double t0, t_new, t_ref;
+#define TIME(label, new_stmt, ref_stmt)                                         \
+    t0 = now_s();                                                                    \
+    for (int it = 0; it < iterations; it++)                                          \
+        for (int i = 0; i < SEGS; i++) {                                             \
+            const seg_t *s = &segs[i];                                               \
+            new_stmt;                                                                \
+        }                                                                            \
+    t_new = now_s() - t0;                                                            \
+    t0 = now_s();                                                                    \
+    for (int it = 0; it < iterations; it++)                                          \
+        for (int i = 0; i < SEGS; i++) {                                             \
+            const seg_t *s = &segs[i];                                               \
+            ref_stmt;                                                                \
+        }                                                                            \
+    t_ref = now_s() - t0;                                                            \
+    sink = p->buffer[0] ^ ref[0];                                                    \
+    printf("%-16s %8.1f ns  per-pixel %8.1f ns  x%.1f\n", label,                      \
+           t_new * 1e9 / ((double)iterations * SEGS), t_ref * 1e9 / ((double)iterations * SEGS), \
+           t_ref / t_new);
+
+    memset(ref, 0, sizeof(ref));
+    TIME("line", gfx_draw_line(p, s->x1, s->y1, s->x2, s->y2),
+         ref_line(ref, s->x1, s->y1, s->x2, s->y2));
+    TIME("fill_rect",
+         gfx_draw_square(p, s->x1 / 2, s->y1 / 2, s->x2 / 2 + 1, s->y2 / 2 + 1),
+         ref_square(ref, s->x1 / 2, s->y1 / 2, s->x2 / 2 + 1, s->y2 / 2 + 1, true));
+    TIME("blit 12x2", gfx_blit_columns(p, s->x1, s->y1, blit_pattern, 12, 2),
+         ref_blit(ref, s->x1, s->y1, blit_pattern, 12, 2));
+    TIME("string x1", gfx_draw_string(p, s->x1 / 4, s->y1, 1, "Tx 1234"),
+         ref_string(ref, s->x1 / 4, s->y1, 1, "Tx 1234"));
+    TIME("string x2", gfx_draw_string(p, s->x1 / 4, s->y1, 2, "1234"),
+         ref_string(ref, s->x1 / 4, s->y1, 2, "1234"));
+#undef TIME
+}
+
+int main(int argc, char **argv) {
+    const char *dir = GFX_GOLDEN_DIR;
+    bool update = false;
+    int iterations = 200;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:un:")) != -1) {
+        switch (opt) {
+        case 'g':
+            dir = optarg;
+            break;
+        case 'u':
+            update = true;
+            break;
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-g golden_dir] [-u] [-n iterations]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ssd1306_t disp;
+    ssd1306_init();
+    if (!gfx_init(&disp, W, H)) {
+        fprintf(stderr, "gfx_init failed\n");
+        return 1;
+    }
+
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++) {
+        const scene_t *sc = &scenes[s];
+        uint8_t ref[BUFSIZE] = {0}, image[BUFSIZE], golden[BUFSIZE];
+        char path[512];
+        bool ok = true;
+
+        gfx_clear_buffer(&disp);
+        sc->draw(&disp, ref);
+        gfx_show(&disp);
+
+        if (sc->has_reference && memcmp(ref, disp.buffer, BUFSIZE) != 0) {
+            printf("%-6s differs from the per-pixel reference\n", sc->name);
+            ok = false;
+        }
+        if (memcmp(ssd1306_emu_gddram(), disp.buffer, BUFSIZE) != 0) {
+            printf("%-6s GDDRAM differs from the framebuffer\n", sc->name);
+            ok = false;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s.pbm", dir, sc->name);
+        emu_image(image);
+        if (update) {
+            if (ok && !ssd1306_emu_write_pbm(path)) {
+                perror(path);
+                ok = false;
+            }
+        } else if (!read_pbm(path, golden, sizeof(golden))) {
+            printf("%-6s cannot read %s\n", sc->name, path);
+            ok = false;
+        } else if (memcmp(golden, image, BUFSIZE) != 0) {
+            printf("%-6s %d pixels differ from %s\n", sc->name, diff_pixels(golden, image), path);
+            ok = false;
+        }
+        printf("%-6s %s\n", sc->name, ok ? (update ? "written" : "ok") : "FAIL");
+        failures += !ok;
+    }
+
+    // Every direction and length from a few origins, some off-screen
+    int line_errors = 0, lines = 0;
+    static const int32_t origins[][2] = {{0, 0}, {64, 16}, {127, 31}, {5, 27}};
+    for (size_t o = 0; o < 4; o++)
+        for (int32_t x = 0; x < W; x += 3)
+            for (int32_t y = 0; y < H; y += 2) {
+                line_errors += check_line(&disp, origins[o][0], origins[o][1], x, y) != 0;
+                lines++;
+            }
+    printf("line properties: %d of %d lines fail\n", line_errors, lines);
+    failures += line_errors != 0;
+
+    if (iterations > 0) {
+        gfx_clear_buffer(&disp);
+        bench(&disp, iterations);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+// Times the MPU-6050 sample decoding of mpu6050_task: the previous path
+// (two 6-byte reads assembled per axis, a float divide per axis and, for a
+// non-trivial mounting, FusionAxesSwap) against imu_decode with the
+// permutation table and with a full calibration matrix. Also checks that
+// imu_decode matches the previous path.
+//
+//   imu_decode_bench [-n samples] [-a alignment 0..23]
+
+#include "imu_decode.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// mpu6050_task before imu_decode
+static void decode_divide(const uint8_t *burst, FusionAxesAlignment alignment,
+                          FusionVector *gyroscope, FusionVector *accelerometer) {
+    int16_t accel[3], gyro[3];
+    for (int i = 0; i < 3; i++)
+        accel[i] = (burst[IMU_BURST_ACCEL + 2*i] << 8) | burst[IMU_BURST_ACCEL + 2*i + 1];
+    for (int i = 0; i < 3; i++)
+        gyro[i] = (burst[IMU_BURST_GYRO + 2*i] << 8) | burst[IMU_BURST_GYRO + 2*i + 1];
+
+    gyroscope->axis.x = gyro[0] / 131.0f;
+    gyroscope->axis.y = gyro[1] / 131.0f;
+    gyroscope->axis.z = gyro[2] / 131.0f;
+    accelerometer->axis.x = accel[0] / 16384.0f;
+    accelerometer->axis.y = accel[1] / 16384.0f;
+    accelerometer->axis.z = accel[2] / 16384.0f;
+    *gyroscope = FusionAxesSwap(*gyroscope, alignment);
+    *accelerometer = FusionAxesSwap(*accelerometer, alignment);
+}
+
+static void nominal(imu_decoder_t *d, uint8_t base, float counts_per_unit,
+                    FusionAxesAlignment alignment) {
+    FusionMatrix m = {.array = {{1.0f / counts_per_unit, 0, 0},
+                                {0, 1.0f / counts_per_unit, 0},
+                                {0, 0, 1.0f / counts_per_unit}}};
+    imu_decode_init(d, base, &m, FUSION_VECTOR_ZERO, alignment);
+}
+
+int main(int argc, char **argv) {
+    size_t samples = 1000000;
+    FusionAxesAlignment alignment = FusionAxesAlignmentPXPYPZ;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:a:")) != -1) {
+        switch (opt) {
+        case 'n': samples = strtoul(optarg, NULL, 0); break;
+        case 'a': alignment = (FusionAxesAlignment)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples] [-a alignment]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint8_t *bursts = malloc(samples * IMU_BURST_SIZE);
+    unsigned seed = 1;
+    for (size_t i = 0; i < samples * IMU_BURST_SIZE; i++) {
+        seed = seed * 1103515245u + 12345u;
+        bursts[i] = seed >> 16;
+    }
+
+    imu_decoder_t gyro_table, accel_table, gyro_full, accel_full;
+    nominal(&gyro_table, IMU_BURST_GYRO, 131.0f, alignment);
+    nominal(&accel_table, IMU_BURST_ACCEL, 16384.0f, alignment);
+    const FusionMatrix calibration = {.array = {{0.0076f, 0.0001f, -0.0002f},
+                                                {0.0001f, 0.0077f, 0.0001f},
+                                                {0.0002f, -0.0001f, 0.0076f}}};
+    imu_decode_init(&gyro_full, IMU_BURST_GYRO, &calibration, (FusionVector){.array = {12, -30, 4}}, alignment);
+    imu_decode_init(&accel_full, IMU_BURST_ACCEL, &calibration, (FusionVector){.array = {120, -80, 300}}, alignment);
+
+    // Same results as the divides, to rounding of 1/131
+    double max_error = 0;
+    for (size_t i = 0; i < samples; i++) {
+        FusionVector g, a;
+        decode_divide(bursts + i * IMU_BURST_SIZE, alignment, &g, &a);
+        const FusionVector g2 = imu_decode(&gyro_table, bursts + i * IMU_BURST_SIZE);
+        const FusionVector a2 = imu_decode(&accel_table, bursts + i * IMU_BURST_SIZE);
+        for (int k = 0; k < 3; k++) {
+            max_error = fmax(max_error, fabs(g.array[k] - g2.array[k]) / fmax(fabs(g.array[k]), 1.0));
+            max_error = fmax(max_error, fabs(a.array[k] - a2.array[k]) / fmax(fabs(a.array[k]), 1.0));
+        }
+    }
+    printf("table path vs divides: table %s, max relative difference %.2g\n",
+           gyro_table.permutation && accel_table.permutation ? "yes" : "no", max_error);
+
+    volatile float sink;
+    float sum;
+    double t0;
+
+#define TIME(label, body)                                                  \
+    do {                                                                   \
+        sum = 0.0f;                                                        \
+        t0 = now_s();                                                      \
+        for (size_t i = 0; i < samples; i++) {                             \
+            const uint8_t *burst = bursts + i * IMU_BURST_SIZE;            \
+            FusionVector g, a;                                             \
+            body;                                                          \
+            sum += g.axis.x + g.axis.y + g.axis.z + a.axis.x + a.axis.y + a.axis.z; \
+        }                                                                  \
+        sink = sum;                                                        \
+        printf("%-24s %6.2f ns/sample\n", label, (now_s() - t0) * 1e9 / samples); \
+    } while (0)
+
+    TIME("divide + FusionAxesSwap", decode_divide(burst, alignment, &g, &a));
+    TIME("imu_decode (table)", (g = imu_decode(&gyro_table, burst), a = imu_decode(&accel_table, burst)));
+    TIME("imu_decode (matrix)", (g = imu_decode(&gyro_full, burst), a = imu_decode(&accel_full, burst)));
+    (void)sink;
+
+    free(bursts);
+    return 0;
+}
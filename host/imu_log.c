@@ -0,0 +1,150 @@
+#include "imu_log.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static bool imu_log_alloc(imu_log_t *log, size_t capacity) {
+    FusionVector *g = realloc(log->gyroscope, capacity * sizeof(*g));
+    if (g)
+        log->gyroscope = g;
+    FusionVector *a = realloc(log->accelerometer, capacity * sizeof(*a));
+    if (a)
+        log->accelerometer = a;
+    float *dt = realloc(log->delta_time, capacity * sizeof(*dt));
+    if (dt)
+        log->delta_time = dt;
+    float *r = realloc(log->roll_ref, capacity * sizeof(*r));
+    if (r)
+        log->roll_ref = r;
+    return g && a && dt && r;
+}
+
+bool imu_log_read_csv(const char *path, imu_log_t *log) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+
+    *log = (imu_log_t){0};
+    size_t capacity = 0;
+    double prev_t = 0;
+    char line[256];
+    bool ok = true;
+    int with_ref = -1;
+
+    while (fgets(line, sizeof(line), f)) {
+        double t;
+        float g[3], a[3], roll = 0;
+        int n = sscanf(line, "%lf,%f,%f,%f,%f,%f,%f,%f", &t, &g[0], &g[1],
+                       &g[2], &a[0], &a[1], &a[2], &roll);
+        if (n < 7)
+            continue; // header or blank line
+        if (with_ref < 0)
+            with_ref = n == 8;
+        if (with_ref != (n == 8)) {
+            ok = false;
+            break;
+        }
+
+        if (log->count == capacity) {
+            capacity = capacity ? capacity * 2 : 4096;
+            if (!imu_log_alloc(log, capacity)) {
+                ok = false;
+                break;
+            }
+        }
+
+        size_t i = log->count++;
+        log->gyroscope[i] = (FusionVector){.axis = {g[0], g[1], g[2]}};
+        log->accelerometer[i] = (FusionVector){.axis = {a[0], a[1], a[2]}};
+        log->delta_time[i] = i ? (float)(t - prev_t) : 0.0f;
+        log->roll_ref[i] = roll;
+        prev_t = t;
+    }
+    fclose(f);
+
+    if (with_ref != 1) {
+        free(log->roll_ref);
+        log->roll_ref = NULL;
+    }
+
+    // The first sample has no predecessor; give it the second one's period
+    if (log->count > 1)
+        log->delta_time[0] = log->delta_time[1];
+
+    if (!ok || log->count == 0) {
+        imu_log_free(log);
+        return false;
+    }
+    return true;
+}
+
+bool imu_log_write_csv(const char *path, const imu_log_t *log) {
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+
+    double t = 0;
+    fprintf(f, log->roll_ref ? "t_s,gx,gy,gz,ax,ay,az,roll_deg\n"
+                             : "t_s,gx,gy,gz,ax,ay,az\n");
+    for (size_t i = 0; i < log->count; i++) {
+        if (i)
+            t += log->delta_time[i];
+        const FusionVector g = log->gyroscope[i], a = log->accelerometer[i];
+        fprintf(f, "%.6f,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g", t, g.axis.x,
+                g.axis.y, g.axis.z, a.axis.x, a.axis.y, a.axis.z);
+        if (log->roll_ref)
+            fprintf(f, ",%.6g", log->roll_ref[i]);
+        fputc('\n', f);
+    }
+    return fclose(f) == 0;
+}
+
+static float noise(unsigned *state) {
+    *state = *state * 1103515245u + 12345u;
+    return (float)((*state >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+// Controller being tilted left and right with some shaking and a few
+// gyroscope spikes above 2000 dps, for checks when no recording is at hand
+bool imu_log_synthesize(imu_log_t *log, size_t count, float rate_hz,
+                        unsigned seed) {
+    *log = (imu_log_t){0};
+    if (count == 0 || !imu_log_alloc(log, count))
+        return false;
+    log->count = count;
+
+    const float dt = 1.0f / rate_hz;
+    float roll = 0;
+    for (size_t i = 0; i < count; i++) {
+        float t = i * dt;
+        float rate = 90.0f * cosf(t * 1.3f);
+        roll += rate * dt;
+
+        float r = FusionDegreesToRadians(roll);
+        float shake = (i / 500) % 4 == 3 ? 0.6f : 0.02f;
+        log->gyroscope[i] = (FusionVector){.axis = {
+                rate + noise(&seed) * 2.0f,
+                noise(&seed) * 2.0f,
+                noise(&seed) * 2.0f,
+        }};
+        if (i % 2000 == 1999)
+            log->gyroscope[i].axis.z = 2100.0f;
+        log->accelerometer[i] = (FusionVector){.axis = {
+                noise(&seed) * shake,
+                sinf(r) + noise(&seed) * shake,
+                cosf(r) + noise(&seed) * shake,
+        }};
+        log->delta_time[i] = dt * (1.0f + noise(&seed) * 0.02f);
+        log->roll_ref[i] = roll;
+    }
+    return true;
+}
+
+void imu_log_free(imu_log_t *log) {
+    free(log->gyroscope);
+    free(log->accelerometer);
+    free(log->delta_time);
+    free(log->roll_ref);
+    *log = (imu_log_t){0};
+}
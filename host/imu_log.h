@@ -0,0 +1,34 @@
+#ifndef IMU_LOG_H
+#define IMU_LOG_H
+
+#include "Fusion.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// IMU recording for offline AHRS runs. On disk it is CSV, one sample per
+// line:
+//
+//   t_s,gx,gy,gz,ax,ay,az[,roll_deg]
+//
+// time in seconds, gyroscope in degrees per second, accelerometer in g (the
+// units mpu6050_task feeds to FusionAhrsUpdateNoMagnetometer). The optional
+// last column is a reference roll angle in degrees (e.g. from a motion
+// capture or a synthetic log); it must be present on every line or none.
+// A first line that does not start with a number is taken as a header.
+
+typedef struct {
+    size_t count;
+    FusionVector *gyroscope;
+    FusionVector *accelerometer;
+    float *delta_time; // seconds since the previous sample
+    float *roll_ref;   // reference roll in degrees, NULL if the log has none
+} imu_log_t;
+
+bool imu_log_read_csv(const char *path, imu_log_t *log);
+bool imu_log_write_csv(const char *path, const imu_log_t *log);
+bool imu_log_synthesize(imu_log_t *log, size_t count, float rate_hz,
+                        unsigned seed);
+void imu_log_free(imu_log_t *log);
+
+#endif // IMU_LOG_H
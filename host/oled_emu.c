@@ -0,0 +1,187 @@
+// Runs the oled1_lib stack against the SSD1306 emulator: draws a status
+// screen with live counters for a number of frames, checks that the
+// emulated GDDRAM matches the framebuffer after every show and reports the
+// SPI traffic and time per frame. It exits non-zero if the GDDRAM differs
+// or a step takes more SPI transactions than the driver is built for:
+//
+//   init:                 one command burst with the whole init table
+//   full frame:           one window command + one data transfer
+//   unchanged frame:      nothing
+//   partial frame:        at most one window + one data transfer per page
+//   scroll start/stop:    one command burst each
+//
+//   oled_emu [-n frames] [-o prefix] [-s png_scale]
+//
+// With -o the last frame is written to <prefix>.pbm and <prefix>.png, and
+// the same frame after 64 steps of hardware scrolling of the bottom half to
+// <prefix>_scroll.png.
+
+#include "gfx.h"
+#include "ssd1306_emu.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Bytes in ssd1306_init_commands (oled1_lib/ssd1306.c)
+#define INIT_COMMAND_BYTES 24
+
+static uint32_t failures;
+
+static void expect(const char *what, uint32_t got, uint32_t want, bool at_most) {
+    if (at_most ? got > want : got != want) {
+        printf("FAIL %s: %u, expected %s%u\n", what, got, at_most ? "<= " : "", want);
+        failures++;
+    }
+}
+
+static void draw_frame(ssd1306_t *p, uint32_t n) {
+    char text[22];
+
+    gfx_clear_square(p, 0, 0, p->width, p->height);
+    snprintf(text, sizeof(text), "BT %s", (n / 30) % 2 ? "conectado" : "desconectado");
+    gfx_draw_string(p, 0, 0, 1, text);
+    snprintf(text, sizeof(text), "Tx %u", n * 7);
+    gfx_draw_string(p, 0, 8, 1, text);
+    snprintf(text, sizeof(text), "%u", n);
+    gfx_draw_string(p, 64, 12, 2, text);
+    gfx_draw_line(p, 0, 31, n % p->width, 31);
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = 300, scale = 4;
+    const char *prefix = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:o:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            frames = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            prefix = optarg;
+            break;
+        case 's':
+            scale = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n frames] [-o prefix] [-s png_scale]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    ssd1306_t disp;
+    ssd1306_init();
+    if (!gfx_init(&disp, GFX_MONO_LCD_WIDTH, GFX_MONO_LCD_HEIGHT)) {
+        fprintf(stderr, "gfx_init failed\n");
+        return 1;
+    }
+
+    ssd1306_emu_stats_t st;
+    ssd1306_emu_get_stats(&st);
+    printf("init: %u transactions, %u command bytes\n", st.transactions,
+           st.cmd_bytes);
+    expect("init transactions", st.transactions, 1, false);
+    expect("init command bytes", st.cmd_bytes, INIT_COMMAND_BYTES, false);
+
+    ssd1306_emu_reset_stats();
+    gfx_draw_square(&disp, 0, 0, disp.width, disp.height);
+    gfx_show(&disp);
+    ssd1306_emu_get_stats(&st);
+    printf("full frame: %u transactions, %u data bytes\n",
+           st.transactions, st.data_bytes);
+    expect("full frame transactions", st.transactions, 2, false);
+    expect("full frame data bytes", st.data_bytes, disp.bufsize, false);
+
+    ssd1306_emu_reset_stats();
+    gfx_show(&disp);
+    ssd1306_emu_get_stats(&st);
+    expect("unchanged frame transactions", st.transactions, 0, false);
+
+    double draw_us = 0, show_us = 0;
+    uint32_t max_bytes = 0, max_trans = 0, mismatches = 0;
+
+    ssd1306_emu_reset_stats();
+    for (uint32_t n = 0; n < frames; n++) {
+        ssd1306_emu_stats_t before;
+        ssd1306_emu_get_stats(&before);
+
+        double t0 = now_us();
+        draw_frame(&disp, n);
+        double t1 = now_us();
+        gfx_show(&disp);
+        double t2 = now_us();
+
+        draw_us += t1 - t0;
+        show_us += t2 - t1;
+
+        ssd1306_emu_get_stats(&st);
+        uint32_t bytes = st.cmd_bytes + st.data_bytes - before.cmd_bytes -
+                         before.data_bytes;
+        uint32_t trans = st.transactions - before.transactions;
+        if (bytes > max_bytes)
+            max_bytes = bytes;
+        if (trans > max_trans)
+            max_trans = trans;
+
+        if (memcmp(ssd1306_emu_gddram(), disp.buffer, disp.bufsize) != 0)
+            mismatches++;
+    }
+
+    ssd1306_emu_get_stats(&st);
+    if (frames) {
+        printf("%u frames: %.1f bytes/frame (max %u), %.1f transactions/frame "
+               "(max %u)\n",
+               frames, (double)(st.cmd_bytes + st.data_bytes) / frames,
+               max_bytes, (double)st.transactions / frames, max_trans);
+        printf("draw %.2f us/frame, show %.2f us/frame\n", draw_us / frames,
+               show_us / frames);
+    }
+    expect("partial frame transactions", max_trans, 2 * disp.pages, true);
+    expect("unknown commands", st.unknown_cmds, 0, false);
+
+    if (prefix) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s.pbm", prefix);
+        if (!ssd1306_emu_write_pbm(path))
+            perror(path);
+        snprintf(path, sizeof(path), "%s.png", prefix);
+        if (!ssd1306_emu_write_png(path, scale))
+            perror(path);
+    }
+
+    // Ticker: let the controller scroll pages 2-3 instead of redrawing them
+    ssd1306_emu_reset_stats();
+    ssd1306_scroll_horizontal(true, 2, 3, SSD1306_SCROLL_2_FRAMES);
+    ssd1306_emu_get_stats(&st);
+    printf("scroll start: %u transactions, %u command bytes\n",
+           st.transactions, st.cmd_bytes);
+    expect("scroll start transactions", st.transactions, 1, false);
+    ssd1306_emu_advance(64 * 2);
+    if (prefix) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s_scroll.png", prefix);
+        if (!ssd1306_emu_write_png(path, scale))
+            perror(path);
+    }
+    ssd1306_emu_reset_stats();
+    ssd1306_scroll_stop();
+    ssd1306_emu_get_stats(&st);
+    expect("scroll stop transactions", st.transactions, 1, false);
+    gfx_mark_dirty(&disp);
+    gfx_show(&disp);
+    if (memcmp(ssd1306_emu_gddram(), disp.buffer, disp.bufsize) != 0)
+        mismatches++;
+
+    if (mismatches)
+        printf("GDDRAM differs from the framebuffer in %u frames\n", mismatches);
+    return mismatches || failures ? 1 : 0;
+}
@@ -0,0 +1,433 @@
+#include "ssd1306_emu.h"
+#include "ssd1306.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    uint8_t gddram[SSD1306_EMU_PAGES][SSD1306_EMU_WIDTH];
+    uint8_t mode; // 0 horizontal, 1 vertical, 2 page
+    uint8_t col, page;
+    uint8_t col_start, col_end, page_start, page_end;
+    uint8_t contrast;
+    uint8_t mux; // multiplex ratio - 1
+    uint8_t start_line;
+    bool invert;
+    bool on;
+
+    // Continuous scroll setup (0x26/0x27/0x29/0x2A/0xA3) and progress
+    bool scrolling, scroll_left, scroll_vertical;
+    uint8_t scroll_page_start, scroll_page_end, scroll_step;
+    uint8_t scroll_rows_per_step, vfixed, vrows, voffset;
+    uint32_t scroll_frames;
+
+    // Command being assembled across bursts
+    uint8_t cmd[8];
+    uint8_t cmd_len, cmd_need;
+} emu_t;
+
+static emu_t emu;
+static ssd1306_emu_stats_t stats;
+
+static struct {
+    bool deferred, pending;
+    const uint8_t *data;
+    size_t len;
+    ssd1306_dma_callback_t callback;
+    void *ctx;
+} dma;
+
+void ssd1306_emu_reset(void) {
+    // Power-on defaults from the datasheet
+    memset(&emu, 0, sizeof(emu));
+    emu.mode = 2;
+    emu.col_end = SSD1306_EMU_WIDTH - 1;
+    emu.page_end = SSD1306_EMU_PAGES - 1;
+    emu.contrast = 0x7F;
+    emu.mux = 63;
+    emu.vrows = 64;
+}
+
+// Frames per scroll step, indexed by the datasheet interval code
+static const uint16_t scroll_intervals[8] = { 5, 64, 128, 256, 3, 4, 25, 2 };
+
+static void scroll_step(void) {
+    for (uint32_t page = emu.scroll_page_start;
+         page <= emu.scroll_page_end && page < SSD1306_EMU_PAGES; page++) {
+        uint8_t *row = emu.gddram[page];
+        if (emu.scroll_left) {
+            uint8_t first = row[0];
+            memmove(row, row + 1, SSD1306_EMU_WIDTH - 1);
+            row[SSD1306_EMU_WIDTH - 1] = first;
+        } else {
+            uint8_t last = row[SSD1306_EMU_WIDTH - 1];
+            memmove(row + 1, row, SSD1306_EMU_WIDTH - 1);
+            row[0] = last;
+        }
+    }
+    if (emu.scroll_vertical && emu.vrows)
+        emu.voffset = (emu.voffset + emu.scroll_rows_per_step) % emu.vrows;
+}
+
+void ssd1306_emu_advance(uint32_t frames) {
+    if (!emu.scrolling)
+        return;
+    emu.scroll_frames += frames;
+    uint32_t interval = scroll_intervals[emu.scroll_step];
+    while (emu.scroll_frames >= interval) {
+        emu.scroll_frames -= interval;
+        scroll_step();
+    }
+}
+
+// Argument bytes following each multi-byte opcode
+static uint8_t arg_count(uint8_t op) {
+    switch (op) {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 1;
+    case 0x21: case 0x22: case 0xA3:
+        return 2;
+    case 0x29: case 0x2A:
+        return 5;
+    case 0x26: case 0x27:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+static void run_command(const uint8_t *c) {
+    uint8_t op = c[0];
+
+    if (op <= 0x0F) { // page mode column LSB
+        emu.col = (emu.col & 0xF0) | op;
+    } else if (op <= 0x1F) { // page mode column MSB
+        emu.col = ((op & 0x07) << 4) | (emu.col & 0x0F);
+    } else if (op >= 0x40 && op <= 0x7F) {
+        // Display start line: only affects scanning, not GDDRAM
+        emu.start_line = op & 0x3F;
+    } else if (op >= 0xB0 && op <= 0xB7) {
+        emu.page = op & 0x07;
+    } else {
+        switch (op) {
+        case 0x20:
+            emu.mode = c[1] & 0x03;
+            break;
+        case 0x21:
+            emu.col_start = emu.col = c[1] & 0x7F;
+            emu.col_end = c[2] & 0x7F;
+            break;
+        case 0x22:
+            emu.page_start = emu.page = c[1] & 0x07;
+            emu.page_end = c[2] & 0x07;
+            break;
+        case 0x26: case 0x27:
+            emu.scroll_left = op & 1;
+            emu.scroll_vertical = false;
+            emu.scroll_page_start = c[2] & 0x07;
+            emu.scroll_step = c[3] & 0x07;
+            emu.scroll_page_end = c[4] & 0x07;
+            break;
+        case 0x29: case 0x2A:
+            emu.scroll_left = op == 0x2A;
+            emu.scroll_vertical = true;
+            emu.scroll_page_start = c[2] & 0x07;
+            emu.scroll_step = c[3] & 0x07;
+            emu.scroll_page_end = c[4] & 0x07;
+            emu.scroll_rows_per_step = c[5] & 0x3F;
+            break;
+        case 0x2E:
+            emu.scrolling = false;
+            break;
+        case 0x2F:
+            emu.scrolling = true;
+            emu.scroll_frames = 0;
+            emu.voffset = 0;
+            break;
+        case 0xA3:
+            emu.vfixed = c[1] & 0x3F;
+            emu.vrows = c[2] & 0x7F;
+            break;
+        case 0x81:
+            emu.contrast = c[1];
+            break;
+        case 0xA6: case 0xA7:
+            emu.invert = op & 1;
+            break;
+        case 0xA8:
+            emu.mux = c[1] & 0x3F;
+            break;
+        case 0xAE: case 0xAF:
+            emu.on = op & 1;
+            break;
+        case 0x8D: case 0xA0: case 0xA1: case 0xA4: case 0xA5:
+        case 0xC0: case 0xC8: case 0xD3: case 0xD5: case 0xD9:
+        case 0xDA: case 0xDB: case 0xE3:
+            // Panel wiring and analog settings, no effect on the image here
+            break;
+        default:
+            stats.unknown_cmds++;
+            break;
+        }
+    }
+}
+
+static void feed_command(uint8_t b) {
+    if (emu.cmd_len == 0)
+        emu.cmd_need = 1 + arg_count(b);
+    emu.cmd[emu.cmd_len++] = b;
+    if (emu.cmd_len == emu.cmd_need) {
+        run_command(emu.cmd);
+        emu.cmd_len = 0;
+    }
+}
+
+static void feed_data(uint8_t b) {
+    emu.gddram[emu.page & 0x07][emu.col & 0x7F] = b;
+
+    switch (emu.mode) {
+    case 0: // horizontal
+        if (emu.col == emu.col_end) {
+            emu.col = emu.col_start;
+            emu.page = emu.page == emu.page_end ? emu.page_start : emu.page + 1;
+        } else {
+            emu.col++;
+        }
+        break;
+    case 1: // vertical
+        if (emu.page == emu.page_end) {
+            emu.page = emu.page_start;
+            emu.col = emu.col == emu.col_end ? emu.col_start : emu.col + 1;
+        } else {
+            emu.page++;
+        }
+        break;
+    default: // page mode wraps within the page
+        emu.col = (emu.col + 1) & 0x7F;
+        break;
+    }
+}
+
+void ssd1306_emu_get_stats(ssd1306_emu_stats_t *s) {
+    *s = stats;
+}
+
+void ssd1306_emu_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t ssd1306_emu_height(void) {
+    return emu.mux + 1;
+}
+
+bool ssd1306_emu_pixel(uint32_t x, uint32_t y) {
+    if (!emu.on || x >= SSD1306_EMU_WIDTH || y >= ssd1306_emu_height())
+        return false;
+    uint32_t row = y;
+    if (emu.voffset && y >= emu.vfixed && y < emu.vfixed + emu.vrows)
+        row = emu.vfixed + (y - emu.vfixed + emu.voffset) % emu.vrows;
+    row = (row + emu.start_line) & 0x3F;
+
+    bool set = (emu.gddram[row >> 3][x] >> (row & 7)) & 1;
+    return set != emu.invert;
+}
+
+uint8_t ssd1306_emu_contrast(void) {
+    return emu.contrast;
+}
+
+const uint8_t *ssd1306_emu_gddram(void) {
+    return &emu.gddram[0][0];
+}
+
+bool ssd1306_emu_write_pbm(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    uint32_t h = ssd1306_emu_height();
+    fprintf(f, "P4\n%d %u\n", SSD1306_EMU_WIDTH, h);
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < SSD1306_EMU_WIDTH; x += 8) {
+            uint8_t b = 0;
+            for (uint32_t i = 0; i < 8; i++)
+                b |= ssd1306_emu_pixel(x + i, y) << (7 - i);
+            fputc(b, f);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void png_chunk(FILE *f, const char *type, const uint8_t *data,
+                      size_t len) {
+    uint8_t hdr[8];
+    put_be32(hdr, len);
+    memcpy(hdr + 4, type, 4);
+    fwrite(hdr, 1, 8, f);
+    if (len)
+        fwrite(data, 1, len, f);
+
+    uint8_t crc[4];
+    put_be32(crc, crc32_update(crc32_update(0, hdr + 4, 4), data, len));
+    fwrite(crc, 1, 4, f);
+}
+
+// 8-bit grayscale PNG, each pixel drawn as a scale x scale block. Lit
+// pixels get a gray level from the contrast register. The image data uses
+// stored (uncompressed) deflate blocks, so no zlib is needed.
+bool ssd1306_emu_write_png(const char *path, uint32_t scale) {
+    if (scale == 0)
+        scale = 1;
+
+    uint32_t w = SSD1306_EMU_WIDTH * scale, h = ssd1306_emu_height() * scale;
+    size_t row = w + 1, raw_len = row * h;
+    size_t blocks = (raw_len + 0xFFFF - 1) / 0xFFFF;
+    size_t z_len = 2 + raw_len + blocks * 5 + 4;
+
+    uint8_t *raw = malloc(raw_len), *z = malloc(z_len);
+    FILE *f = fopen(path, "wb");
+    if (!raw || !z || !f) {
+        free(raw);
+        free(z);
+        if (f)
+            fclose(f);
+        return false;
+    }
+
+    uint8_t lit = 0x40 + (emu.contrast * 0xBF) / 0xFF;
+    for (uint32_t y = 0; y < h; y++) {
+        raw[y * row] = 0; // filter: none
+        for (uint32_t x = 0; x < w; x++)
+            raw[y * row + 1 + x] =
+                ssd1306_emu_pixel(x / scale, y / scale) ? lit : 0;
+    }
+
+    // zlib stream of stored blocks
+    uint8_t *o = z;
+    *o++ = 0x78;
+    *o++ = 0x01;
+    uint32_t a = 1, b = 0;
+    for (size_t off = 0; off < raw_len; off += 0xFFFF) {
+        size_t n = raw_len - off < 0xFFFF ? raw_len - off : 0xFFFF;
+        *o++ = off + n == raw_len;
+        *o++ = n;
+        *o++ = n >> 8;
+        *o++ = ~n;
+        *o++ = ~n >> 8;
+        memcpy(o, raw + off, n);
+        o += n;
+        for (size_t i = 0; i < n; i++) {
+            a = (a + raw[off + i]) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    put_be32(o, (b << 16) | a);
+
+    static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint8_t ihdr[13];
+    put_be32(ihdr, w);
+    put_be32(ihdr + 4, h);
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 0;  // grayscale
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // no interlace
+
+    fwrite(sig, 1, sizeof(sig), f);
+    png_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+    png_chunk(f, "IDAT", z, z_len);
+    png_chunk(f, "IEND", NULL, 0);
+
+    free(raw);
+    free(z);
+    return fclose(f) == 0;
+}
+
+// Transport for oled1_lib (see the SSD1306_HOST guards in ssd1306.c)
+
+void ssd1306_interface_init(void) {}
+
+void ssd1306_hard_reset(void) {
+    ssd1306_emu_reset();
+}
+
+bool ssd1306_dma_init(void) {
+    return true;
+}
+
+bool ssd1306_dma_busy(void) {
+    return dma.pending;
+}
+
+void ssd1306_dma_wait(void) {
+    ssd1306_emu_dma_complete();
+}
+
+void ssd1306_write_commands(const uint8_t *commands, size_t len) {
+    ssd1306_dma_wait();
+    stats.transactions++;
+    stats.cmd_bytes += len;
+    while (len--)
+        feed_command(*commands++);
+}
+
+void ssd1306_write_data(uint8_t data) {
+    ssd1306_dma_wait();
+    stats.transactions++;
+    stats.data_bytes++;
+    feed_data(data);
+}
+
+// Completes immediately, so the callback runs before this returns, unless
+// deferred DMA is on
+void ssd1306_write_data_dma(const uint8_t *data, size_t len,
+                            ssd1306_dma_callback_t callback, void *ctx) {
+    ssd1306_dma_wait();
+    stats.transactions++;
+    stats.data_bytes += len;
+    dma.data = data;
+    dma.len = len;
+    dma.callback = callback;
+    dma.ctx = ctx;
+    dma.pending = true;
+    if (!dma.deferred)
+        ssd1306_emu_dma_complete();
+}
+
+void ssd1306_emu_set_deferred_dma(bool deferred) {
+    dma.deferred = deferred;
+    if (!deferred)
+        ssd1306_emu_dma_complete();
+}
+
+bool ssd1306_emu_dma_pending(void) {
+    return dma.pending;
+}
+
+void ssd1306_emu_dma_complete(void) {
+    if (!dma.pending)
+        return;
+    dma.pending = false;
+    for (size_t i = 0; i < dma.len; i++)
+        feed_data(dma.data[i]);
+    if (dma.callback)
+        dma.callback(dma.ctx);
+}
@@ -0,0 +1,51 @@
+#ifndef SSD1306_EMU_H
+#define SSD1306_EMU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for the SSD1306 panel. It implements the transport half
+// of oled1_lib (ssd1306_write_commands, ssd1306_write_data_dma, ...) and
+// interprets the byte stream the way the controller would: addressing
+// modes, column/page pointers and windows, contrast, invert, display on/off,
+// start line and continuous scrolling.
+
+#define SSD1306_EMU_WIDTH 128
+#define SSD1306_EMU_PAGES 8
+
+typedef struct {
+    uint32_t transactions; // CS/DC bursts: one per write call
+    uint32_t cmd_bytes;
+    uint32_t data_bytes;
+    uint32_t unknown_cmds; // opcodes the emulator does not understand
+} ssd1306_emu_stats_t;
+
+void ssd1306_emu_reset(void);
+void ssd1306_emu_get_stats(ssd1306_emu_stats_t *stats);
+void ssd1306_emu_reset_stats(void);
+
+// Visible image: multiplex ratio rows, invert and display on/off applied
+uint32_t ssd1306_emu_height(void);
+bool ssd1306_emu_pixel(uint32_t x, uint32_t y);
+uint8_t ssd1306_emu_contrast(void);
+
+// Lets the panel run for a number of display frames, which is what moves an
+// active hardware scroll
+void ssd1306_emu_advance(uint32_t frames);
+
+// Deferred DMA: ssd1306_write_data_dma only queues the transfer, which
+// lands (GDDRAM written, callback run) on ssd1306_emu_dma_complete() or, as
+// on the hardware, on the next write or ssd1306_dma_wait(). Off by default,
+// where transfers complete before ssd1306_write_data_dma returns.
+void ssd1306_emu_set_deferred_dma(bool deferred);
+bool ssd1306_emu_dma_pending(void);
+void ssd1306_emu_dma_complete(void);
+
+// Raw GDDRAM, page-major like the framebuffer in gfx.h
+const uint8_t *ssd1306_emu_gddram(void);
+
+bool ssd1306_emu_write_pbm(const char *path);
+bool ssd1306_emu_write_png(const char *path, uint32_t scale);
+
+#endif // SSD1306_EMU_H
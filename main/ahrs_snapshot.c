@@ -0,0 +1,54 @@
+#include "ahrs_snapshot.h"
+#include "flash_store.h"
+
+#include <string.h>
+
+#define AHRS_SNAPSHOT_MAGIC 0xA5A50049u
+
+typedef struct {
+    uint32_t magic;
+    FusionAhrsSnapshot snapshot;
+    uint32_t check; // FNV-1a of snapshot
+} ahrs_snapshot_record_t;
+
+// Not zeroed at start-up: after a reset without power loss it still holds
+// what the previous run kept. A cold boot leaves garbage that fails the check.
+static ahrs_snapshot_record_t __uninitialized_ram(ram_record);
+
+static uint32_t snapshot_check(const FusionAhrsSnapshot *snapshot) {
+    const uint8_t *p = (const uint8_t *)snapshot;
+    uint32_t h = 0x811C9DC5;
+    for (size_t i = 0; i < sizeof(*snapshot); i++)
+        h = (h ^ p[i]) * 0x01000193;
+    return h;
+}
+
+// Rejects garbage that happens to pass the check and snapshots taken with a
+// different quaternion layout
+static bool snapshot_sane(const FusionAhrsSnapshot *snapshot) {
+    const float *q = snapshot->quaternion.array;
+    const float n = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+    return n > 0.8f && n < 1.2f && snapshot->rampedGain >= 0.0f && snapshot->rampedGain < 100.0f;
+}
+
+bool ahrs_snapshot_load(FusionAhrsSnapshot *snapshot) {
+    if (ram_record.magic == AHRS_SNAPSHOT_MAGIC &&
+        ram_record.check == snapshot_check(&ram_record.snapshot) &&
+        snapshot_sane(&ram_record.snapshot)) {
+        *snapshot = ram_record.snapshot;
+        return true;
+    }
+    return flash_store_read(FLASH_STORE_AHRS_SNAPSHOT, snapshot, sizeof(*snapshot)) &&
+           snapshot_sane(snapshot);
+}
+
+void ahrs_snapshot_keep(const FusionAhrsSnapshot *snapshot) {
+    // Byte copy so the padding the check covers is the one stored
+    memcpy(&ram_record.snapshot, snapshot, sizeof(*snapshot));
+    ram_record.check = snapshot_check(&ram_record.snapshot);
+    ram_record.magic = AHRS_SNAPSHOT_MAGIC;
+}
+
+bool ahrs_snapshot_save(const FusionAhrsSnapshot *snapshot) {
+    return flash_store_write(FLASH_STORE_AHRS_SNAPSHOT, snapshot, sizeof(*snapshot));
+}
@@ -0,0 +1,15 @@
+#ifndef AHRS_SNAPSHOT_H_
+#define AHRS_SNAPSHOT_H_
+
+#include "pico/stdlib.h"
+#include "Fusion.h"
+
+// FusionAhrs state kept across resets so the orientation is usable right
+// after boot: continuously in a RAM section the C runtime does not clear,
+// which survives watchdog and brownout resets while the SRAM keeps its
+// contents, and on request in flash for the next power-up
+bool ahrs_snapshot_load(FusionAhrsSnapshot *snapshot); // RAM, then flash
+void ahrs_snapshot_keep(const FusionAhrsSnapshot *snapshot);
+bool ahrs_snapshot_save(const FusionAhrsSnapshot *snapshot);
+
+#endif // AHRS_SNAPSHOT_H_
@@ -0,0 +1,19 @@
+#ifndef AHRS_TUNING_H_
+#define AHRS_TUNING_H_
+
+// Generated by host/ahrs_sweep; do not edit by hand.
+//
+// Defaults (FusionAhrsInitialise settings and the original thresholds);
+// regenerate from recorded sessions with
+//
+//   host/build/ahrs_sweep -o main/ahrs_tuning.h session.csv...
+
+#define AHRS_TUNING_GAIN 0.500f
+#define AHRS_TUNING_ACCELERATION_REJECTION 90.0f
+#define AHRS_TUNING_RECOVERY_TRIGGER_PERIOD 0
+
+// mpu6050_task units (see tilt_enter in main.c)
+#define AHRS_TUNING_TILT_ENTER 1200
+#define AHRS_TUNING_TILT_EXIT 1000
+
+#endif // AHRS_TUNING_H_
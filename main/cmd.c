@@ -0,0 +1,88 @@
+#include "cmd.h"
+#include "hc06.h"
+
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+
+#define CMD_RX_MASK (CMD_RX_BUF_SIZE - 1)
+
+static uint8_t rx_buf[CMD_RX_BUF_SIZE];
+static volatile uint16_t rx_head; // written by the ISR
+static volatile uint16_t rx_tail; // written by cmd_rx_task
+static volatile uint32_t rx_overflows;
+
+static uint32_t rx_frames;
+static uint32_t rx_errors;
+
+static TaskHandle_t rx_task_handle;
+static cmd_handler_t cmd_handler;
+
+static void cmd_uart_isr(void) {
+    BaseType_t woken = pdFALSE;
+
+    while (uart_is_readable(HC06_UART_ID)) {
+        uint8_t c = (uint8_t)uart_getc(HC06_UART_ID);
+        uint16_t next = (rx_head + 1) & CMD_RX_MASK;
+        if (next == rx_tail) {
+            rx_overflows++;
+            continue;
+        }
+        rx_buf[rx_head] = c;
+        rx_head = next;
+    }
+
+    if (rx_task_handle)
+        vTaskNotifyGiveFromISR(rx_task_handle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void cmd_rx_task(void *p) {
+    uint8_t frame[FRAME_SIZE];
+    int len = 0;
+    bool resync = false;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (rx_tail != rx_head) {
+            frame[len++] = rx_buf[rx_tail];
+            rx_tail = (rx_tail + 1) & CMD_RX_MASK;
+            if (len < FRAME_SIZE)
+                continue;
+
+            if (frame[FRAME_SIZE - 1] != FRAME_END) {
+                // Drop one byte and try again, same as the host decoder
+                if (!resync)
+                    rx_errors++;
+                resync = true;
+                frame[0] = frame[1];
+                frame[1] = frame[2];
+                frame[2] = frame[3];
+                len = FRAME_SIZE - 1;
+                continue;
+            }
+
+            resync = false;
+            len = 0;
+            rx_frames++;
+            cmd_handler(frame[0], (int16_t)(frame[1] | (frame[2] << 8)));
+        }
+    }
+}
+
+// Must be called after hc06_init, which polls the same UART for AT replies.
+void cmd_init(cmd_handler_t handler) {
+    cmd_handler = handler;
+    xTaskCreate(cmd_rx_task, "cmd_rx", 1024, NULL, 2, &rx_task_handle);
+
+    int irq = uart_get_index(HC06_UART_ID) ? UART1_IRQ : UART0_IRQ;
+    irq_set_exclusive_handler(irq, cmd_uart_isr);
+    irq_set_enabled(irq, true);
+    uart_set_irq_enables(HC06_UART_ID, true, false);
+}
+
+void cmd_get_stats(cmd_stats_t *stats) {
+    stats->frames = rx_frames;
+    stats->errors = rx_errors;
+    stats->overflows = rx_overflows;
+}
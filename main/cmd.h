@@ -0,0 +1,24 @@
+#ifndef CMD_H_
+#define CMD_H_
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "pico/stdlib.h"
+
+#include "protocol.h"
+
+#define CMD_RX_BUF_SIZE 64 // power of two
+
+typedef void (*cmd_handler_t)(uint8_t cmd, int16_t value);
+
+typedef struct {
+    uint32_t frames;
+    uint32_t errors;
+    uint32_t overflows;
+} cmd_stats_t;
+
+void cmd_init(cmd_handler_t handler);
+void cmd_get_stats(cmd_stats_t *stats);
+
+#endif // CMD_H_
@@ -0,0 +1,138 @@
+#include "display.h"
+
+// Double-buffered OLED output.
+//
+// The caller draws into the back buffer at its own pace and calls
+// display_present() when a frame is complete. If the flush task is idle, the
+// changed spans of the back buffer are copied into the front buffer and the
+// task is woken to send them over DMA; if a flush is still running the call
+// returns false right away and the pending changes go out with the next
+// present. Nothing on this path ever waits for the SPI.
+//
+// Presents closer together than 1/DISPLAY_MAX_FPS, less one tick of wake-up
+// jitter, are refused the same way.
+// The time from display_begin_frame() to display_present() plus the last
+// flush time is checked against DISPLAY_FRAME_BUDGET_US. Once a frame goes
+// over budget, display_begin_frame() returns false until a frame fits in
+// 3/4 of the budget, so the caller can leave out the non-critical parts.
+
+#define NOTIFY_FRAME 0
+#define NOTIFY_FLUSHED 1
+
+// A task paced at exactly 1/DISPLAY_MAX_FPS wakes on tick boundaries, so the
+// time between its presents can come out a little short of the period
+#define DISPLAY_MIN_FRAME_US \
+    (1000000 / DISPLAY_MAX_FPS - 1000000 / configTICK_RATE_HZ)
+
+static ssd1306_t front, back;
+GFX_FRAMEBUFFER(front_buf, GFX_MONO_LCD_WIDTH, GFX_MONO_LCD_HEIGHT);
+GFX_FRAMEBUFFER(back_buf, GFX_MONO_LCD_WIDTH, GFX_MONO_LCD_HEIGHT);
+static TaskHandle_t display_task_handle;
+static volatile bool flushing;
+static display_stats_t stats;
+
+static bool frame_timed;
+static uint32_t frame_start_us;
+static uint32_t last_present_us;
+static uint32_t fps_window_us;
+static uint32_t fps_frames;
+
+static void display_flush_done(void *ctx) {
+    (void)ctx;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveIndexedFromISR(display_task_handle, NOTIFY_FLUSHED, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void display_task(void *p) {
+    (void)p;
+    while (1) {
+        ulTaskNotifyTakeIndexed(NOTIFY_FRAME, pdTRUE, portMAX_DELAY);
+
+        uint32_t start = time_us_32();
+        gfx_show_async(&front, display_flush_done, NULL);
+        ulTaskNotifyTakeIndexed(NOTIFY_FLUSHED, pdTRUE, portMAX_DELAY);
+
+        stats.flush_us = time_us_32() - start;
+        if (stats.flush_us > stats.flush_us_max)
+            stats.flush_us_max = stats.flush_us;
+        flushing = false;
+    }
+}
+
+bool display_init(void) {
+    ssd1306_init();
+    if (!gfx_init_with_buffer(&front, GFX_MONO_LCD_WIDTH, GFX_MONO_LCD_HEIGHT,
+                              front_buf))
+        return false;
+    if (!gfx_init_with_buffer(&back, GFX_MONO_LCD_WIDTH, GFX_MONO_LCD_HEIGHT,
+                              back_buf))
+        return false;
+
+    // Both start blank; the first present sends the whole panel from front
+    gfx_mark_clean(&back);
+
+    last_present_us = time_us_32() - DISPLAY_MIN_FRAME_US;
+    fps_window_us = time_us_32();
+
+    return xTaskCreate(display_task, "display", 512, NULL,
+                       DISPLAY_TASK_PRIORITY, &display_task_handle) == pdPASS;
+}
+
+ssd1306_t *display_back_buffer(void) {
+    return &back;
+}
+
+// Starts timing a frame. Returns false while the display is degraded: draw
+// only what must be up to date and skip the rest.
+bool display_begin_frame(void) {
+    frame_start_us = time_us_32();
+    frame_timed = true;
+    return !stats.degraded;
+}
+
+bool display_present(void) {
+    uint32_t now = time_us_32();
+
+    if (now - fps_window_us >= 1000000) {
+        stats.fps = fps_frames;
+        fps_frames = 0;
+        fps_window_us = now;
+    }
+
+    if (frame_timed) {
+        stats.render_us = now - frame_start_us;
+        frame_timed = false;
+
+        uint32_t cost = stats.render_us + stats.flush_us;
+        if (cost > DISPLAY_FRAME_BUDGET_US) {
+            stats.over_budget++;
+            stats.degraded = true;
+        } else if (cost < DISPLAY_FRAME_BUDGET_US * 3 / 4) {
+            stats.degraded = false;
+        }
+    }
+
+    if (flushing) {
+        stats.busy++;
+        return false;
+    }
+    if (now - last_present_us < DISPLAY_MIN_FRAME_US) {
+        stats.limited++;
+        return false;
+    }
+    if (!gfx_is_dirty(&back) && !gfx_is_dirty(&front))
+        return true;
+
+    gfx_copy_dirty(&front, &back);
+    last_present_us = now;
+    flushing = true;
+    stats.frames++;
+    fps_frames++;
+    xTaskNotifyGiveIndexed(display_task_handle, NOTIFY_FRAME);
+    return true;
+}
+
+void display_get_stats(display_stats_t *s) {
+    *s = stats;
+}
@@ -0,0 +1,39 @@
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "gfx.h"
+
+#define DISPLAY_TASK_PRIORITY tskIDLE_PRIORITY
+
+// Frames faster than this are refused by display_present()
+#ifndef DISPLAY_MAX_FPS
+#define DISPLAY_MAX_FPS 10
+#endif
+
+// Drawing plus flush time a frame may take before the display degrades
+#ifndef DISPLAY_FRAME_BUDGET_US
+#define DISPLAY_FRAME_BUDGET_US 4000
+#endif
+
+typedef struct {
+    uint32_t frames;       // frames handed to the flush task
+    uint32_t busy;         // display_present() calls refused because a flush was running
+    uint32_t limited;      // display_present() calls refused by the frame-rate limit
+    uint32_t over_budget;  // frames whose draw + flush time exceeded the budget
+    uint32_t fps;          // frames presented during the last full second
+    uint32_t render_us;    // last display_begin_frame() to display_present()
+    uint32_t flush_us;     // last flush, start of the transfer to completion
+    uint32_t flush_us_max;
+    bool degraded;         // display_begin_frame() is asking for a reduced frame
+} display_stats_t;
+
+bool display_init(void);
+ssd1306_t *display_back_buffer(void);
+bool display_begin_frame(void);
+bool display_present(void);
+void display_get_stats(display_stats_t *stats);
+
+#endif // DISPLAY_H_
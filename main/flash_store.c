@@ -0,0 +1,190 @@
+#include "flash_store.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "hardware/sync.h"
+#include <string.h>
+
+// Two sectors used in turn. Page 0 of a sector is a header record whose
+// data is a sequence number; the sector with the newest valid header holds
+// the records, from page 1 on. Compaction fills the other sector and
+// programs its header last, so until that page is written the old sector
+// stays the live one and a power cut loses at most the record being
+// written.
+#define FLASH_STORE_SECTORS 2
+#define FLASH_STORE_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_STORE_SECTORS * FLASH_SECTOR_SIZE)
+#define FLASH_STORE_PAGES (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define FLASH_STORE_MAGIC 0xF5A7
+#define FLASH_STORE_ERASED 0xFFFF
+#define FLASH_STORE_HEADER_SLOT 0xFE
+
+typedef struct {
+    uint16_t magic;
+    uint8_t slot;
+    uint8_t length;
+    uint32_t check; // FNV-1a of slot, length and data
+    uint8_t data[FLASH_STORE_MAX_LENGTH];
+} flash_record_t;
+
+_Static_assert(sizeof(flash_record_t) == FLASH_PAGE_SIZE, "one record per flash page");
+
+// Staging for program/erase, which need their source in RAM
+static flash_record_t page;
+static flash_record_t keep[FLASH_STORE_SLOTS];
+
+static uint32_t page_offset(int sector, int index) {
+    return FLASH_STORE_OFFSET + sector * FLASH_SECTOR_SIZE + index * FLASH_PAGE_SIZE;
+}
+
+static const flash_record_t *record_at(int sector, int index) {
+    return (const flash_record_t *)(uintptr_t)(XIP_BASE + page_offset(sector, index));
+}
+
+static uint32_t record_check(const flash_record_t *r) {
+    uint32_t h = 0x811C9DC5;
+    h = (h ^ r->slot) * 0x01000193;
+    h = (h ^ r->length) * 0x01000193;
+    for (int i = 0; i < r->length; i++)
+        h = (h ^ r->data[i]) * 0x01000193;
+    return h;
+}
+
+static bool record_valid(const flash_record_t *r) {
+    return r->magic == FLASH_STORE_MAGIC && r->slot < FLASH_STORE_SLOTS &&
+           r->length <= FLASH_STORE_MAX_LENGTH && r->check == record_check(r);
+}
+
+static bool header_valid(const flash_record_t *r, uint32_t *sequence) {
+    if (r->magic != FLASH_STORE_MAGIC || r->slot != FLASH_STORE_HEADER_SLOT ||
+        r->length != sizeof(*sequence) || r->check != record_check(r))
+        return false;
+    memcpy(sequence, r->data, sizeof(*sequence));
+    return true;
+}
+
+// Sector holding the records (-1 if neither has a valid header) and its
+// sequence number
+static int live_sector(uint32_t *sequence) {
+    uint32_t seq[FLASH_STORE_SECTORS];
+    bool valid[FLASH_STORE_SECTORS];
+
+    for (int s = 0; s < FLASH_STORE_SECTORS; s++)
+        valid[s] = header_valid(record_at(s, 0), &seq[s]);
+    int live = -1;
+    if (valid[0] && valid[1])
+        live = (int32_t)(seq[1] - seq[0]) > 0 ? 1 : 0;
+    else if (valid[0] || valid[1])
+        live = valid[0] ? 0 : 1;
+    if (live >= 0 && sequence)
+        *sequence = seq[live];
+    return live;
+}
+
+// Latest valid record of the slot in the given sector, and the first
+// erased page (-1 if full or sector is -1). Records are appended in page
+// order, so the scan stops at the first erased page.
+static const flash_record_t *find(int sector, flash_store_slot_t slot, int *free_index) {
+    const flash_record_t *latest = NULL;
+    int i;
+
+    if (sector < 0) {
+        if (free_index)
+            *free_index = -1;
+        return NULL;
+    }
+    for (i = 1; i < FLASH_STORE_PAGES; i++) {
+        const flash_record_t *r = record_at(sector, i);
+        if (r->magic == FLASH_STORE_ERASED)
+            break;
+        if (r->slot == slot && record_valid(r))
+            latest = r;
+    }
+    if (free_index)
+        *free_index = i < FLASH_STORE_PAGES ? i : -1;
+    return latest;
+}
+
+static void program_page(int sector, int index, const flash_record_t *r) {
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_program(page_offset(sector, index), (const uint8_t *)r, FLASH_PAGE_SIZE);
+    restore_interrupts(ints);
+}
+
+bool flash_store_read(flash_store_slot_t slot, void *data, size_t len) {
+    const flash_record_t *r = find(live_sector(NULL), slot, NULL);
+    if (!r || r->length != len)
+        return false;
+    memcpy(data, r->data, len);
+    return true;
+}
+
+// Blocks the caller for up to ~50 ms when the records have to be moved to
+// the other sector, with interrupts off while flash is busy (code runs
+// from flash). Callers in different tasks (cmd_rx_task, mpu6050_task) are
+// serialised by suspending the scheduler before the shared staging page is
+// touched.
+bool flash_store_write(flash_store_slot_t slot, const void *data, size_t len) {
+    if (slot >= FLASH_STORE_SLOTS || len > FLASH_STORE_MAX_LENGTH)
+        return false;
+
+    vTaskSuspendAll();
+
+    memset(&page, 0xFF, sizeof(page));
+    page.magic = FLASH_STORE_MAGIC;
+    page.slot = slot;
+    page.length = len;
+    memcpy(page.data, data, len);
+    page.check = record_check(&page);
+
+    uint32_t sequence = 0;
+    int sector = live_sector(&sequence);
+    int free_index;
+    const flash_record_t *latest = find(sector, slot, &free_index);
+    if (latest && latest->length == len && memcmp(latest->data, data, len) == 0) {
+        xTaskResumeAll(); // unchanged, spare the flash
+        return true;
+    }
+
+    if (free_index < 0) {
+        // Live sector full (or none yet): move the latest record of each
+        // other slot to the other sector, append this one and switch over
+        // by writing the header
+        int kept = 0;
+        for (int s = 0; s < FLASH_STORE_SLOTS; s++) {
+            const flash_record_t *r = s == slot ? NULL : find(sector, s, NULL);
+            if (r)
+                keep[kept++] = *r;
+        }
+
+        const int target = sector == 0 ? 1 : 0;
+        uint32_t ints = save_and_disable_interrupts();
+        flash_range_erase(page_offset(target, 0), FLASH_SECTOR_SIZE);
+        restore_interrupts(ints);
+
+        for (int i = 0; i < kept; i++)
+            program_page(target, 1 + i, &keep[i]);
+        program_page(target, 1 + kept, &page);
+
+        // The new record is programmed, so its staging page is free
+        memset(&page, 0xFF, sizeof(page));
+        page.magic = FLASH_STORE_MAGIC;
+        page.slot = FLASH_STORE_HEADER_SLOT;
+        page.length = sizeof(sequence);
+        sequence++;
+        memcpy(page.data, &sequence, sizeof(sequence));
+        page.check = record_check(&page);
+        program_page(target, 0, &page);
+
+        sector = target;
+        free_index = 1 + kept;
+    } else {
+        program_page(sector, free_index, &page);
+    }
+
+    bool ok = live_sector(NULL) == sector && record_valid(record_at(sector, free_index)) &&
+              memcmp(record_at(sector, free_index)->data, data, len) == 0;
+
+    xTaskResumeAll();
+    return ok;
+}
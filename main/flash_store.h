@@ -0,0 +1,29 @@
+#ifndef FLASH_STORE_H_
+#define FLASH_STORE_H_
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+// Small records kept in the last two flash sectors, which the program image
+// never reaches, so they survive reboots and re-flashing. Each write
+// appends one page; when the sector is full the latest record of every
+// slot is copied to the other sector, which only takes over once the copy
+// is complete, so a power cut during the copy loses nothing.
+//
+// That copy erases a sector with interrupts off for ~45 ms, longer than the
+// UART1 RX FIFO (32 bytes, ~33 ms at 9600 baud) lasts, so link commands
+// arriving meanwhile can be lost; hosts resend commands that go unanswered
+// (see Sessao.upload in python/calibracao.py).
+typedef enum {
+    FLASH_STORE_GYRO_OFFSET = 0,
+    FLASH_STORE_IMU_CALIBRATION,
+    FLASH_STORE_AHRS_SNAPSHOT,
+    FLASH_STORE_SLOTS
+} flash_store_slot_t;
+
+#define FLASH_STORE_MAX_LENGTH (FLASH_PAGE_SIZE - 8) // bytes per record
+
+bool flash_store_read(flash_store_slot_t slot, void *data, size_t len);
+bool flash_store_write(flash_store_slot_t slot, const void *data, size_t len);
+
+#endif // FLASH_STORE_H_
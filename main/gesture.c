@@ -0,0 +1,146 @@
+#include "gesture.h"
+
+#include <string.h>
+
+// Shake: GESTURE_SHAKE_SWINGS half-cycles above GESTURE_SHAKE_PEAK within
+// the window, with enough mean energy that sensor noise cannot do it
+#define GESTURE_SHAKE_PEAK 1.2f   // g
+#define GESTURE_SHAKE_SWINGS 4
+#define GESTURE_SHAKE_RMS 0.7f    // g
+
+// Punch and flick: a push above PEAK, braking past -BRAKE along the push
+// within PUSH_SAMPLES, then quiet within SETTLE_SAMPLES
+#define GESTURE_PUNCH_PEAK 1.5f   // g, horizontal
+#define GESTURE_PUNCH_BRAKE 0.8f
+#define GESTURE_FLICK_PEAK 1.2f   // g, vertical
+#define GESTURE_FLICK_BRAKE 0.6f
+#define GESTURE_PUSH_SAMPLES 20
+#define GESTURE_SETTLE_SAMPLES 30
+
+// Quiet: mean |linear|^2 over the last GESTURE_QUIET_SAMPLES below
+// GESTURE_QUIET^2; GESTURE_REARM_SAMPLES of it re-arm after a gesture
+#define GESTURE_QUIET 0.2f        // g
+#define GESTURE_QUIET_SAMPLES 8
+#define GESTURE_REARM_SAMPLES 10
+
+#define GESTURE_ENERGY_UNIT 1e4f  // 1 / (0.01 g)^2
+#define GESTURE_ENERGY_MAX 1000000u
+
+#define ENERGY(g) ((uint32_t)((g) * (g) * GESTURE_ENERGY_UNIT))
+
+_Static_assert((GESTURE_WINDOW & (GESTURE_WINDOW - 1)) == 0, "window must be a power of two");
+_Static_assert(GESTURE_QUIET_SAMPLES <= GESTURE_WINDOW, "quiet span must fit the window");
+
+static void impulse_reset(gesture_impulse_t *m) {
+    m->state = GESTURE_IMPULSE_IDLE;
+    m->samples = 0;
+}
+
+static bool impulse_update(gesture_impulse_t *m, FusionVector v, bool quiet, float peak, float brake) {
+    switch (m->state) {
+    case GESTURE_IMPULSE_IDLE: {
+        const float magnitude = FusionVectorMagnitude(v);
+        if (magnitude > peak) {
+            m->direction = FusionVectorMultiplyScalar(v, 1.0f / magnitude);
+            m->state = GESTURE_IMPULSE_PUSH;
+            m->samples = 0;
+        }
+        return false;
+    }
+    case GESTURE_IMPULSE_PUSH:
+        if (FusionVectorDotProduct(v, m->direction) < -brake) {
+            m->state = GESTURE_IMPULSE_BRAKE;
+            m->samples = 0;
+        } else if (++m->samples > GESTURE_PUSH_SAMPLES) {
+            impulse_reset(m); // too slow for a gesture
+        }
+        return false;
+    case GESTURE_IMPULSE_BRAKE:
+        if (quiet) {
+            impulse_reset(m);
+            return true;
+        }
+        if (++m->samples > GESTURE_SETTLE_SAMPLES)
+            impulse_reset(m); // kept moving: part of something else
+        return false;
+    }
+    return false;
+}
+
+void gesture_init(gesture_engine_t *g) {
+    memset(g, 0, sizeof(*g));
+    g->armed = true;
+}
+
+// Clears what the last gesture left in the window
+static void gesture_rearm(gesture_engine_t *g) {
+    memset(g->swing, 0, sizeof(g->swing));
+    memset(g->swing_sign, 0, sizeof(g->swing_sign));
+    g->swings = 0;
+    impulse_reset(&g->punch);
+    impulse_reset(&g->flick);
+    g->armed = true;
+}
+
+gesture_t gesture_update(gesture_engine_t *g, FusionVector linear, FusionVector earth) {
+    // Slide the window: drop the oldest sample, add this one
+    const uint8_t head = g->head;
+    const uint8_t recent_tail = (head - GESTURE_QUIET_SAMPLES) & (GESTURE_WINDOW - 1);
+    uint32_t energy = (uint32_t)(FusionVectorMagnitudeSquared(linear) * GESTURE_ENERGY_UNIT);
+    if (energy > GESTURE_ENERGY_MAX)
+        energy = GESTURE_ENERGY_MAX;
+    g->energy_sum += energy - g->energy[head];
+    g->recent_sum += energy - g->energy[recent_tail];
+    g->swings -= g->swing[head];
+    g->energy[head] = energy;
+    g->swing[head] = 0;
+    g->head = (head + 1) & (GESTURE_WINDOW - 1);
+
+    const bool quiet = g->recent_sum < ENERGY(GESTURE_QUIET) * GESTURE_QUIET_SAMPLES;
+    if (quiet) {
+        if (g->quiet_run < UINT8_MAX)
+            g->quiet_run++;
+    } else {
+        g->quiet_run = 0;
+    }
+
+    if (!g->armed) {
+        if (g->quiet_run >= GESTURE_REARM_SAMPLES)
+            gesture_rearm(g);
+        return GESTURE_NONE;
+    }
+
+    // A swing ends when an axis passes the peak with the opposite sign of
+    // its previous swing
+    for (int i = 0; i < 3; i++) {
+        const float a = linear.array[i];
+        const int8_t sign = a > GESTURE_SHAKE_PEAK ? 1 : a < -GESTURE_SHAKE_PEAK ? -1 : 0;
+        if (sign != 0 && sign != g->swing_sign[i]) {
+            g->swing_sign[i] = sign;
+            if (!g->swing[head]) {
+                g->swing[head] = 1;
+                g->swings++;
+            }
+        }
+    }
+
+    gesture_t gesture = GESTURE_NONE;
+    if (g->swings >= GESTURE_SHAKE_SWINGS &&
+        g->energy_sum > ENERGY(GESTURE_SHAKE_RMS) * GESTURE_WINDOW) {
+        gesture = GESTURE_SHAKE;
+    } else {
+        const FusionVector horizontal = {.axis = {earth.axis.x, earth.axis.y, 0.0f}};
+        const FusionVector vertical = {.axis = {0.0f, 0.0f, earth.axis.z}};
+        if (impulse_update(&g->punch, horizontal, quiet, GESTURE_PUNCH_PEAK, GESTURE_PUNCH_BRAKE))
+            gesture = GESTURE_PUNCH;
+        if (impulse_update(&g->flick, vertical, quiet, GESTURE_FLICK_PEAK, GESTURE_FLICK_BRAKE) &&
+            gesture == GESTURE_NONE)
+            gesture = GESTURE_FLICK;
+    }
+
+    if (gesture != GESTURE_NONE) {
+        g->armed = false;
+        g->quiet_run = 0;
+    }
+    return gesture;
+}
@@ -0,0 +1,60 @@
+#ifndef GESTURE_H_
+#define GESTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Fusion.h"
+
+// Streaming gesture recognizer fed once per IMU sample with the AHRS
+// linear acceleration (sensor frame) and Earth acceleration (gravity
+// removed), both in g. Work per sample is constant: the features are kept
+// incrementally over a ring window and each gesture is a small state
+// machine.
+//
+//   shake: several strong back-and-forth swings on any sensor axis
+//   punch: horizontal thrust followed by braking, then stillness
+//   flick: the same along the vertical
+//
+// After a gesture fires the recognizer waits for the controller to settle
+// before it can fire again.
+typedef enum {
+    GESTURE_NONE = 0,
+    GESTURE_SHAKE,
+    GESTURE_PUNCH,
+    GESTURE_FLICK,
+} gesture_t;
+
+#define GESTURE_WINDOW 64 // samples, power of two; holds 4 swings at 3 Hz
+
+typedef enum {
+    GESTURE_IMPULSE_IDLE = 0,
+    GESTURE_IMPULSE_PUSH,
+    GESTURE_IMPULSE_BRAKE,
+} gesture_impulse_state_t;
+
+// Push/brake/settle machine of punch and flick
+typedef struct {
+    gesture_impulse_state_t state;
+    uint8_t samples;        // in the current state
+    FusionVector direction; // of the push, unit
+} gesture_impulse_t;
+
+typedef struct {
+    uint32_t energy[GESTURE_WINDOW]; // |linear|^2 in (0.01 g)^2
+    uint8_t swing[GESTURE_WINDOW];   // a shake half-cycle ended here
+    uint8_t head;
+    uint32_t energy_sum;  // over the window
+    uint32_t recent_sum;  // over the last GESTURE_QUIET_SAMPLES
+    uint8_t swings;       // over the window
+    int8_t swing_sign[3]; // sign of the last swing per axis
+    uint8_t quiet_run;    // consecutive quiet samples
+    bool armed;
+    gesture_impulse_t punch;
+    gesture_impulse_t flick;
+} gesture_engine_t;
+
+void gesture_init(gesture_engine_t *g);
+gesture_t gesture_update(gesture_engine_t *g, FusionVector linear, FusionVector earth);
+
+#endif // GESTURE_H_
@@ -0,0 +1,80 @@
+#include "imu_cal.h"
+#include "flash_store.h"
+
+// Stored record. Bump IMU_CAL_VERSION whenever the meaning of a field
+// changes, so records written by older firmware are ignored instead of
+// being read with the new meaning.
+//   1: offsets in raw counts (stored without a version)
+//   2: offsets in deg/s and g
+#define IMU_CAL_VERSION 2
+
+typedef struct {
+    uint32_t version;
+    imu_calibration_t cal;
+} imu_cal_record_t;
+
+static void sensor_defaults(imu_cal_sensor_t *sensor) {
+    sensor->misalignment = FUSION_IDENTITY_MATRIX;
+    sensor->sensitivity = FUSION_VECTOR_ONES;
+    sensor->offset = FUSION_VECTOR_ZERO;
+}
+
+void imu_cal_defaults(imu_calibration_t *cal) {
+    sensor_defaults(&cal->gyroscope);
+    sensor_defaults(&cal->accelerometer);
+}
+
+// Falls back to the defaults (nominal datasheet scale) if nothing is
+// stored or the record is from another version
+bool imu_cal_load(imu_calibration_t *cal) {
+    imu_cal_record_t record;
+    if (flash_store_read(FLASH_STORE_IMU_CALIBRATION, &record, sizeof(record)) &&
+        record.version == IMU_CAL_VERSION) {
+        *cal = record.cal;
+        return true;
+    }
+    imu_cal_defaults(cal);
+    return false;
+}
+
+bool imu_cal_save(const imu_calibration_t *cal) {
+    const imu_cal_record_t record = {.version = IMU_CAL_VERSION, .cal = *cal};
+    return flash_store_write(FLASH_STORE_IMU_CALIBRATION, &record, sizeof(record));
+}
+
+bool imu_cal_set_param(imu_calibration_t *cal, int index, int16_t value) {
+    if (index < 0 || index >= IMU_CAL_PARAMS)
+        return false;
+
+    imu_cal_sensor_t *sensor = index < IMU_CAL_PARAMS_PER_SENSOR ? &cal->gyroscope : &cal->accelerometer;
+    int i = index % IMU_CAL_PARAMS_PER_SENSOR;
+
+    if (i < 9)
+        sensor->misalignment.array[i / 3][i % 3] = (float)value / IMU_CAL_GAIN_ONE;
+    else if (i < 12)
+        sensor->sensitivity.array[i - 9] = (float)value / IMU_CAL_GAIN_ONE;
+    else
+        sensor->offset.array[i - 12] = (float)value / IMU_CAL_OFFSET_ONE;
+    return true;
+}
+
+int16_t imu_cal_params_check(const int16_t *params) {
+    uint32_t h = 0x811C9DC5;
+    for (int i = 0; i < IMU_CAL_PARAMS; i++) {
+        const uint16_t v = (uint16_t)params[i];
+        h = (h ^ (v & 0xFF)) * 0x01000193;
+        h = (h ^ (v >> 8)) * 0x01000193;
+    }
+    return (int16_t)(h % 32767 + 1);
+}
+
+// FusionCalibrationInertial(raw / counts_per_unit, misalignment, sensitivity,
+// offset) == applied->matrix * (raw - applied->offset)
+void imu_cal_prepare(const imu_cal_sensor_t *sensor, float counts_per_unit,
+                     imu_cal_applied_t *applied) {
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+            applied->matrix.array[row][col] = sensor->misalignment.array[row][col] *
+                                              sensor->sensitivity.array[col] / counts_per_unit;
+    applied->offset = FusionVectorMultiplyScalar(sensor->offset, counts_per_unit);
+}
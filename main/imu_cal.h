@@ -0,0 +1,48 @@
+#ifndef IMU_CAL_H_
+#define IMU_CAL_H_
+
+#include "pico/stdlib.h"
+#include "Fusion.h"
+
+// FusionCalibrationInertial coefficients of one sensor, with the
+// uncalibrated measurement in nominal units (counts / counts per unit at
+// the configured range), so they stay valid if the range changes
+typedef struct {
+    FusionMatrix misalignment;
+    FusionVector sensitivity;
+    FusionVector offset; // deg/s or g
+} imu_cal_sensor_t;
+
+typedef struct {
+    imu_cal_sensor_t gyroscope;
+    imu_cal_sensor_t accelerometer;
+} imu_calibration_t;
+
+// misalignment * diag(sensitivity) / counts per unit as one matrix, applied
+// as matrix * (raw - offset); see imu_decode_init
+typedef struct {
+    FusionMatrix matrix;
+    FusionVector offset; // raw counts
+} imu_cal_applied_t;
+
+// Coefficients travel over the command channel as int16 parameters:
+// per sensor (gyroscope, then accelerometer) the misalignment in row-major
+// order and the sensitivity in Q14, then the offset in Q10
+#define IMU_CAL_PARAMS_PER_SENSOR 15
+#define IMU_CAL_PARAMS            (2 * IMU_CAL_PARAMS_PER_SENSOR)
+#define IMU_CAL_GAIN_ONE          16384
+#define IMU_CAL_OFFSET_ONE        1024
+
+// CMD_CAL_COMMIT carries this check of the IMU_CAL_PARAMS values in index
+// order (FNV-1a of their little-endian bytes folded into 1 to 32767), so a
+// lost or repeated CMD_CAL_VALUE frame is caught before anything is stored
+int16_t imu_cal_params_check(const int16_t *params);
+
+void imu_cal_defaults(imu_calibration_t *cal);
+bool imu_cal_load(imu_calibration_t *cal);
+bool imu_cal_save(const imu_calibration_t *cal);
+bool imu_cal_set_param(imu_calibration_t *cal, int index, int16_t value);
+void imu_cal_prepare(const imu_cal_sensor_t *sensor, float counts_per_unit,
+                     imu_cal_applied_t *applied);
+
+#endif // IMU_CAL_H_
@@ -0,0 +1,43 @@
+#include "imu_decode.h"
+
+// d applies FusionAxesSwap(matrix * (raw - offset), alignment)
+void imu_decode_init(imu_decoder_t *d, uint8_t base, const FusionMatrix *matrix,
+                     FusionVector offset, FusionAxesAlignment alignment) {
+    // Alignment as a matrix: column j is where sensor axis j ends up
+    FusionMatrix swap;
+    for (int j = 0; j < 3; j++) {
+        FusionVector unit = FUSION_VECTOR_ZERO;
+        unit.array[j] = 1.0f;
+        unit = FusionAxesSwap(unit, alignment);
+        for (int i = 0; i < 3; i++)
+            swap.array[i][j] = unit.array[i];
+    }
+
+    d->base = base;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            d->matrix.array[i][j] = swap.array[i][0] * matrix->array[0][j] +
+                                    swap.array[i][1] * matrix->array[1][j] +
+                                    swap.array[i][2] * matrix->array[2][j];
+
+    // M * (raw - offset) == M * raw - M * offset
+    const FusionVector bias = FusionMatrixMultiplyVector(d->matrix, offset);
+
+    d->permutation = true;
+    d->biased = false;
+    for (int i = 0; i < 3; i++) {
+        int nonzero = 0;
+        for (int j = 0; j < 3; j++) {
+            if (d->matrix.array[i][j] != 0.0f) {
+                nonzero++;
+                d->source[i] = base + 2 * j;
+                d->scale[i] = d->matrix.array[i][j];
+            }
+        }
+        if (nonzero != 1)
+            d->permutation = false;
+        d->bias[i] = bias.array[i];
+        if (bias.array[i] != 0.0f)
+            d->biased = true;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef IMU_DECODE_H_
+#define IMU_DECODE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Fusion.h"
+#include "mpu6050.h"
+
+// mpu6050_read_burst layout: accel, temperature and gyro as big-endian
+// int16
+#define IMU_BURST_SIZE  MPU6050_BURST_SIZE
+#define IMU_BURST_ACCEL 0
+#define IMU_BURST_TEMP  6
+#define IMU_BURST_GYRO  8
+
+// Big-endian decoding, calibration, unit scale and mounting alignment
+// folded into one transform per sensor, built once by imu_decode_init.
+// When the result is a signed permutation with per-axis scale (no
+// cross-axis terms, as with the default calibration) each output axis is
+// a table lookup of its source bytes and one multiply; otherwise a 3x3
+// product.
+typedef struct {
+    bool permutation;
+    bool biased;       // any bias is non-zero
+    uint8_t source[3]; // burst offset of the bytes feeding each output axis
+    float scale[3];
+    float bias[3];     // subtracted after scaling
+    uint8_t base;      // burst offset of the sensor
+    FusionMatrix matrix;
+} imu_decoder_t;
+
+static inline int16_t imu_decode_be16(const uint8_t *p) {
+    return (int16_t)((p[0] << 8) | p[1]);
+}
+
+// Raw counts of one sensor, in sensor axes
+static inline void imu_decode_raw(const uint8_t burst[IMU_BURST_SIZE], uint8_t base,
+                                  int16_t raw[3]) {
+    for (int i = 0; i < 3; i++)
+        raw[i] = imu_decode_be16(burst + base + 2 * i);
+}
+
+static inline FusionVector imu_decode(const imu_decoder_t *d,
+                                      const uint8_t burst[IMU_BURST_SIZE]) {
+    FusionVector v;
+    if (d->permutation) {
+        for (int i = 0; i < 3; i++)
+            v.array[i] = imu_decode_be16(burst + d->source[i]) * d->scale[i];
+    } else {
+        for (int i = 0; i < 3; i++)
+            v.array[i] = imu_decode_be16(burst + d->base + 2 * i);
+        v = FusionMatrixMultiplyVector(d->matrix, v);
+    }
+    if (d->biased) {
+        for (int i = 0; i < 3; i++)
+            v.array[i] -= d->bias[i];
+    }
+    return v;
+}
+
+void imu_decode_init(imu_decoder_t *d, uint8_t base, const FusionMatrix *matrix,
+                     FusionVector offset, FusionAxesAlignment alignment);
+
+#endif // IMU_DECODE_H_
@@ -2,6 +2,7 @@
 #include <task.h>
 #include <semphr.h>
 #include <queue.h>
+#include <timers.h>
 
 #include "ssd1306.h"
 #include "gfx.h"
@@ -15,27 +16,100 @@
 #include "Fusion.h"
 
 #include "hc06.h"
+#include "cmd.h"
+#include "protocol.h"
+#include "display.h"
+#include "ahrs_tuning.h"
+#include "flash_store.h"
+#include "imu_cal.h"
+#include "imu_decode.h"
+#include "ahrs_snapshot.h"
+#include "gesture.h"
+#include "trig_bench.h"
+
+// The SSD1306 status display, PICO_EMB_DISPLAY in main/CMakeLists.txt
+#ifndef DISPLAY_ENABLED
+#define DISPLAY_ENABLED 0
+#endif
 
-#define MPU_ADDRESS 0x68
 #define I2C_SDA_GPIO 4
 #define I2C_SCL_GPIO 5
 
-#define CODE_TILT_LEFT   8
-#define CODE_TILT_RIGHT  9
-#define HC06_STATE_PIN 15
-
-const int VRX = 26;
-const int VRY = 27;
+#define UART_TX_GPIO 8 // UART1 to the HC-06
+#define UART_RX_GPIO 9
 
-const uint BTN_HOME   = 10;
-const uint BTN_A      = 12;
-const uint BTN_B      = 11;
-const uint BTN_1      = 14;
-const uint BTN_2      = 13;
+#define HC06_STATE_PIN 15
 
-const uint CONECTION_LED = 16;
-const uint START_LED     = 21;
-const uint BUZZER        = 17;
+#define IMU_SAMPLE_RATE 100 // Hz, mpu6050_task loop
+
+// How the MPU-6050 sits on the board relative to the controller axes
+#define IMU_AXES_ALIGNMENT FusionAxesAlignmentPXPYPZ
+
+// +-1000 deg/s so quick tilts do not clip, and a 44 Hz low-pass below the
+// Nyquist frequency of the loop
+static const mpu6050_config_t imu_config = {
+    .gyro_range = MPU6050_GYRO_1000DPS,
+    .accel_range = MPU6050_ACCEL_4G,
+    .dlpf = MPU6050_DLPF_44HZ,
+    .sample_rate_hz = IMU_SAMPLE_RATE,
+};
+
+// Start-up gyroscope calibration: the first second is averaged if the
+// controller is held still (every axis within this spread, in deg/s)
+#define GYRO_CALIBRATION_SAMPLES IMU_SAMPLE_RATE
+#define GYRO_CALIBRATION_SPREAD 2.0f
+
+// The offset learned at run time is written back to flash at most this
+// often, and only if it moved by more than GYRO_OFFSET_SAVE_DELTA deg/s
+#define GYRO_OFFSET_SAVE_PERIOD_S 600
+#define GYRO_OFFSET_SAVE_DELTA 0.1f
+
+// A kept AHRS snapshot is only resumed if its gravity direction is within
+// this angle of the first accelerometer sample
+#define AHRS_RESTORE_MAX_ANGLE 10.0f
+
+#define CAL_CAPTURE_MAX_SAMPLES 1000 // 10 s
+
+// IMU recording for the host tools: kept in RAM, then sent six frames per
+// sample (about 15 s for the longest recording at 9600 baud), leaving this
+// many queue slots for live events
+#define IMU_RECORD_MAX_SAMPLES 600 // 6 s
+#define IMU_RECORD_QUEUE_RESERVE 8
+
+#define VRX 26
+#define VRY 27
+
+#define BTN_HOME   10
+#define BTN_A      12
+#define BTN_B      11
+#define BTN_1      14
+#define BTN_2      13
+
+#define BATTERY_ADC_GPIO  29 // VSYS/3
+#define BATTERY_ADC_INPUT 3
+
+#define CONECTION_LED 16
+#define START_LED     21
+#define BUZZER        17
+
+#if DISPLAY_ENABLED
+// The SSD1306 pins come from the OLED1_* CMake settings; they must stay off
+// everything above, and off the HC-06 enable pin (hc06.h)
+#define GPIO_BIT(gpio) (1ull << (gpio))
+#define CONTROLLER_GPIOS                                                        \
+    (GPIO_BIT(I2C_SDA_GPIO) | GPIO_BIT(I2C_SCL_GPIO) | GPIO_BIT(UART_TX_GPIO) | \
+     GPIO_BIT(UART_RX_GPIO) | GPIO_BIT(HC06_STATE_PIN) | GPIO_BIT(HC06_ENABLE_PIN) | \
+     GPIO_BIT(VRX) | GPIO_BIT(VRY) | GPIO_BIT(BTN_HOME) | GPIO_BIT(BTN_A) |     \
+     GPIO_BIT(BTN_B) | GPIO_BIT(BTN_1) | GPIO_BIT(BTN_2) |                      \
+     GPIO_BIT(BATTERY_ADC_GPIO) | GPIO_BIT(CONECTION_LED) | GPIO_BIT(START_LED) | \
+     GPIO_BIT(BUZZER))
+#define DISPLAY_GPIOS                                                   \
+    (GPIO_BIT(PIN_SCK) | GPIO_BIT(PIN_TX) | GPIO_BIT(PIN_CS) |          \
+     GPIO_BIT(SSD1306_DATA_CMD_SEL) | GPIO_BIT(SSD1306_RST_PIN))
+#if CONTROLLER_GPIOS & DISPLAY_GPIOS
+#error "The SSD1306 pins (OLED1_PIN_*) collide with the controller's GPIOs"
+#endif
+#endif
 
 typedef struct {
     int button;
@@ -43,6 +117,49 @@ typedef struct {
 } btn_t;
 
 static QueueHandle_t xQueue;
+static TimerHandle_t xBuzzerTimer;
+static SemaphoreHandle_t xAdcSemaphore; // adc_select_input + adc_read pairs
+
+// Tunables, changed at run time by the host through the command channel
+static volatile int report_period_ms = 50;
+static volatile int joy_deadzone     = 30;
+static volatile int tilt_enter       = AHRS_TUNING_TILT_ENTER;
+static volatile int tilt_exit        = AHRS_TUNING_TILT_EXIT;
+
+static volatile uint32_t events_sent;
+static volatile uint32_t queue_drops;
+static volatile bool bt_connected;
+
+// Inertial calibration: edited by the command handler, picked up by
+// mpu6050_task when cal_changed is set
+static imu_calibration_t cal_pending;
+static volatile bool cal_changed;
+static int cal_index;
+static int16_t cal_params[IMU_CAL_PARAMS]; // as received, for the commit check
+static uint32_t cal_received;              // one bit per parameter
+static volatile int cal_capture_request; // samples, 0 when idle
+static volatile bool ahrs_save_request;
+static volatile int imu_record_request; // samples, 0 when idle
+
+typedef struct {
+    int total, samples;
+    int32_t accel_sum[3], gyro_sum[3];
+    int16_t accel_min[3], accel_max[3];
+} cal_capture_t;
+
+typedef struct {
+    int total, samples;
+    int sent; // frames
+    int16_t data[IMU_RECORD_MAX_SAMPLES][6]; // gyroscope, accelerometer
+} imu_record_t;
+
+static imu_record_t imu_record;
+
+static void send_event(int button, int value) {
+    btn_t evt = { .button = button, .value = value };
+    if (xQueueSend(xQueue, &evt, 0) != pdTRUE)
+        queue_drops++;
+}
 
 void oled1_btn_led_init(void) {
     gpio_init(CONECTION_LED); gpio_set_dir(CONECTION_LED, GPIO_OUT);
@@ -65,100 +182,227 @@ void hc06_state_task(void *p) {
         vTaskDelay(pdMS_TO_TICKS(2000));
         bool state = gpio_get(HC06_STATE_PIN);
         gpio_put(CONECTION_LED, state);
+        bt_connected = state;
         //printf("%d",pareado);
         vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
-static void mpu6050_reset(void) {
-    uint8_t buf[] = { 0x6B, 0x00 };
-    i2c_write_blocking(i2c_default, MPU_ADDRESS, buf, 2, false);
+void btn_callback(uint gpio, uint32_t events) {
+    btn_t evt;
+    evt.value = (events == GPIO_IRQ_EDGE_FALL) ? 1 : 0;
+    if      (gpio == BTN_2) evt.button = CODE_BTN_2;
+    else if (gpio == BTN_HOME ) evt.button = CODE_BTN_HOME;
+    else if (gpio == BTN_A    ) evt.button = CODE_BTN_A;
+    else if (gpio == BTN_B    ) evt.button = CODE_BTN_B;
+    else if (gpio == BTN_1    ) evt.button = CODE_BTN_1;
+    if (xQueueSendFromISR(xQueue, &evt, NULL) != pdTRUE)
+        queue_drops++;
 }
 
-static void mpu6050_read_raw(int16_t accel[3], int16_t gyro[3], int16_t *temp) {
-    uint8_t buffer[6], reg;
-
-    reg = 0x3B;
-    i2c_write_blocking(i2c_default, MPU_ADDRESS, &reg, 1, true);
-    i2c_read_blocking(i2c_default, MPU_ADDRESS, buffer, 6, false);
-    for (int i = 0; i < 3; i++)
-        accel[i] = (buffer[2*i] << 8) | buffer[2*i + 1];
-
-    reg = 0x43;
-    i2c_write_blocking(i2c_default, MPU_ADDRESS, &reg, 1, true);
-    i2c_read_blocking(i2c_default, MPU_ADDRESS, buffer, 6, false);
-    for (int i = 0; i < 3; i++)
-        gyro[i] = (buffer[2*i] << 8) | buffer[2*i + 1];
+static void buzzer_off_callback(TimerHandle_t timer) {
+    gpio_put(BUZZER, 0);
+}
 
-    reg = 0x41;
-    i2c_write_blocking(i2c_default, MPU_ADDRESS, &reg, 1, true);
-    i2c_read_blocking(i2c_default, MPU_ADDRESS, buffer, 2, false);
-    *temp = (buffer[0] << 8) | buffer[1];
+static void send_stats(void) {
+    cmd_stats_t rx;
+    cmd_get_stats(&rx);
+    send_event(CODE_STAT_UPTIME_S,     (int16_t)(xTaskGetTickCount() / configTICK_RATE_HZ));
+    send_event(CODE_STAT_EVENTS_SENT,  (int16_t)events_sent);
+    send_event(CODE_STAT_QUEUE_DROPS,  (int16_t)queue_drops);
+    send_event(CODE_STAT_RX_FRAMES,    (int16_t)rx.frames);
+    send_event(CODE_STAT_RX_ERRORS,    (int16_t)rx.errors);
+    send_event(CODE_STAT_RX_OVERFLOWS, (int16_t)rx.overflows);
+#if DISPLAY_ENABLED
+    display_stats_t disp;
+    display_get_stats(&disp);
+    send_event(CODE_STAT_DISPLAY_FPS,         (int16_t)disp.fps);
+    send_event(CODE_STAT_DISPLAY_FLUSH_US,
+               disp.flush_us_max > INT16_MAX ? INT16_MAX : (int16_t)disp.flush_us_max);
+    send_event(CODE_STAT_DISPLAY_DROPS,       (int16_t)(disp.busy + disp.limited));
+    send_event(CODE_STAT_DISPLAY_OVER_BUDGET, (int16_t)disp.over_budget);
+#endif
+    send_event(CODE_STAT_END, 0);
 }
 
-void btn_callback(uint gpio, uint32_t events) {
-    btn_t evt;
-    evt.value = (events == GPIO_IRQ_EDGE_FALL) ? 1 : 0;
-    if      (gpio == BTN_2) evt.button = 6;
-    else if (gpio == BTN_HOME ) evt.button = 2;
-    else if (gpio == BTN_A    ) evt.button = 3;
-    else if (gpio == BTN_B    ) evt.button = 4;
-    else if (gpio == BTN_1    ) evt.button = 5;
-    xQueueSendFromISR(xQueue, &evt, NULL);
+static void host_cmd_handler(uint8_t cmd, int16_t value) {
+    switch (cmd) {
+    case CMD_SET_REPORT_RATE:
+        // At most one report per tick: a shorter period would round down to
+        // vTaskDelay(0) and the joystick tasks would flood the queue
+        if (value > 0)
+            report_period_ms = 1000 / (value < configTICK_RATE_HZ ? value : configTICK_RATE_HZ);
+        break;
+    case CMD_SET_DEADZONE:
+        if (value >= 0 && value <= 255)
+            joy_deadzone = value;
+        break;
+    case CMD_SET_TILT_ENTER:
+        if (value >= 0 && value >= tilt_exit)
+            tilt_enter = value;
+        break;
+    case CMD_SET_TILT_EXIT:
+        if (value >= 0 && value <= tilt_enter)
+            tilt_exit = value;
+        break;
+    case CMD_BUZZER:
+        if (value > 0) {
+            gpio_put(BUZZER, 1);
+            xTimerChangePeriod(xBuzzerTimer, pdMS_TO_TICKS(value) ? pdMS_TO_TICKS(value) : 1, 0);
+        } else {
+            gpio_put(BUZZER, 0);
+        }
+        break;
+    case CMD_LED:
+        gpio_put(START_LED, value != 0);
+        break;
+    case CMD_STATS_DUMP:
+        send_stats();
+        break;
+    case CMD_CAL_CAPTURE:
+        if (value > 0 && value <= CAL_CAPTURE_MAX_SAMPLES)
+            cal_capture_request = value;
+        break;
+    case CMD_CAL_INDEX:
+        cal_index = value;
+        break;
+    case CMD_CAL_VALUE:
+        if (imu_cal_set_param(&cal_pending, cal_index, value)) {
+            cal_params[cal_index] = value;
+            cal_received |= 1u << cal_index;
+        }
+        cal_index++;
+        break;
+    case CMD_CAL_COMMIT:
+        if (value == 0) {
+            imu_cal_defaults(&cal_pending);
+        } else if (cal_received != (1u << IMU_CAL_PARAMS) - 1 ||
+                   value != imu_cal_params_check(cal_params)) {
+            // A frame was lost or repeated: drop the upload, keep what is stored
+            cal_received = 0;
+            imu_cal_load(&cal_pending);
+            send_event(CODE_CAL_SAVED, -1);
+            break;
+        }
+        cal_received = 0;
+        send_event(CODE_CAL_SAVED, imu_cal_save(&cal_pending));
+        cal_changed = true;
+        break;
+    case CMD_AHRS_SAVE:
+        ahrs_save_request = true;
+        break;
+    case CMD_IMU_RECORD:
+        if (value > 0 && value <= IMU_RECORD_MAX_SAMPLES)
+            imu_record_request = value;
+        break;
+    default:
+        break;
+    }
 }
 
 void x_task(void *p) {
-    btn_t evt;
     int samples[5] = {0}, idx = 0;
     while (1) {
+        xSemaphoreTake(xAdcSemaphore, portMAX_DELAY);
         adc_select_input(0);
         samples[idx] = adc_read();
+        xSemaphoreGive(xAdcSemaphore);
         idx = (idx + 1) % 5;
         int sum = 0;
         for (int i = 0; i < 5; i++) sum += samples[i];
         int mean = sum / 5;
         int delta = mean - 2048;
         int scaled = (delta * 255) / 2048;
-        if (scaled > -30 && scaled < 30) scaled = 0;
-        if (scaled != 0) {
-            evt.button = 0;
-            evt.value  = scaled;
-            xQueueSend(xQueue, &evt, 0);
-        }
-        vTaskDelay(pdMS_TO_TICKS(50));
+        if (scaled > -joy_deadzone && scaled < joy_deadzone) scaled = 0;
+        if (scaled != 0)
+            send_event(CODE_AXIS_X, scaled);
+        vTaskDelay(pdMS_TO_TICKS(report_period_ms));
     }
 }
 
 void y_task(void *p) {
-    btn_t evt;
     int samples[5] = {0}, idx = 0;
     while (1) {
+        xSemaphoreTake(xAdcSemaphore, portMAX_DELAY);
         adc_select_input(1);
         samples[idx] = adc_read();
+        xSemaphoreGive(xAdcSemaphore);
         idx = (idx + 1) % 5;
         int sum = 0;
         for (int i = 0; i < 5; i++) sum += samples[i];
         int mean = sum / 5;
         int delta = mean - 2048;
         int scaled = (delta * 255) / 2048;
-        if (scaled > -30 && scaled < 30) scaled = 0;
-        if (scaled != 0) {
-            evt.button = 1;
-            evt.value  = -scaled;
-            xQueueSend(xQueue, &evt, 0);
+        if (scaled > -joy_deadzone && scaled < joy_deadzone) scaled = 0;
+        if (scaled != 0)
+            send_event(CODE_AXIS_Y, -scaled);
+        vTaskDelay(pdMS_TO_TICKS(report_period_ms));
+    }
+}
+
+#if DISPLAY_ENABLED
+static int battery_mv(void) {
+    xSemaphoreTake(xAdcSemaphore, portMAX_DELAY);
+    adc_select_input(BATTERY_ADC_INPUT);
+    int raw = adc_read();
+    xSemaphoreGive(xAdcSemaphore);
+    return raw * 3 * 3300 / 4096;
+}
+
+// Redraws only the status lines whose text changed and hands the frame to
+// the display task; never waits for the panel. While the display is over
+// its time budget only the link state is kept up to date.
+void status_task(void *p) {
+    ssd1306_t *disp = display_back_buffer();
+    char lines[4][22], text[22];
+    TickType_t wake = xTaskGetTickCount();
+
+    memset(lines, 0, sizeof(lines));
+    while (1) {
+        cmd_stats_t rx;
+        cmd_get_stats(&rx);
+        bool full = display_begin_frame();
+
+        for (int i = 0; i < (full ? 4 : 1); i++) {
+            switch (i) {
+            case 0:
+                snprintf(text, sizeof(text), "BT %s",
+                         bt_connected ? "conectado" : "desconectado");
+                break;
+            case 1:
+                snprintf(text, sizeof(text), "Bat %d mV", battery_mv());
+                break;
+            case 2:
+                snprintf(text, sizeof(text), "Tx %lu Drop %lu",
+                         (unsigned long)events_sent, (unsigned long)queue_drops);
+                break;
+            default:
+                snprintf(text, sizeof(text), "Rx %lu Err %lu",
+                         (unsigned long)rx.frames, (unsigned long)rx.errors);
+                break;
+            }
+            if (strcmp(text, lines[i]) == 0)
+                continue;
+            strcpy(lines[i], text);
+            gfx_clear_square(disp, 0, i * 8, disp->width, 8);
+            gfx_draw_string(disp, 0, i * 8, 1, text);
         }
-        vTaskDelay(pdMS_TO_TICKS(50));
+
+        display_present();
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000 / DISPLAY_MAX_FPS));
     }
 }
+#endif
 
 void uart_task(void *p) {
     btn_t evt;
 
     uart_init(HC06_UART_ID, HC06_BAUD_RATE);
-    gpio_set_function(8, GPIO_FUNC_UART);
-    gpio_set_function(9, GPIO_FUNC_UART);
+    gpio_set_function(UART_TX_GPIO, GPIO_FUNC_UART);
+    gpio_set_function(UART_RX_GPIO, GPIO_FUNC_UART);
     hc06_init("mariokart", "1234");
-    
+    cmd_init(host_cmd_handler);
+
     while (1) {
         if (xQueueReceive(xQueue, &evt, portMAX_DELAY)) {
             uint8_t b   = (uint8_t)evt.button;
@@ -168,13 +412,104 @@ void uart_task(void *p) {
             uart_putc(HC06_UART_ID, b);
             uart_putc(HC06_UART_ID, lsb);
             uart_putc(HC06_UART_ID, msb);
-            uart_putc(HC06_UART_ID, 0xFF);
+            uart_putc(HC06_UART_ID, FRAME_END);
+            events_sent++;
+        }
+    }
+}
+
+// Writes the offset to flash if it differs enough from the stored one
+static void gyro_offset_save(FusionVector offset, FusionVector *stored) {
+    const FusionVector d = FusionVectorSubtract(offset, *stored);
+    if (fabsf(d.axis.x) <= GYRO_OFFSET_SAVE_DELTA && fabsf(d.axis.y) <= GYRO_OFFSET_SAVE_DELTA &&
+        fabsf(d.axis.z) <= GYRO_OFFSET_SAVE_DELTA)
+        return;
+    if (flash_store_write(FLASH_STORE_GYRO_OFFSET, &offset, sizeof(offset)))
+        *stored = offset;
+}
+
+static void cal_capture_add(cal_capture_t *c, const int16_t accel[3], const int16_t gyro[3]) {
+    for (int i = 0; i < 3; i++) {
+        c->accel_sum[i] += accel[i];
+        c->gyro_sum[i] += gyro[i];
+        if (c->samples == 0 || accel[i] < c->accel_min[i])
+            c->accel_min[i] = accel[i];
+        if (c->samples == 0 || accel[i] > c->accel_max[i])
+            c->accel_max[i] = accel[i];
+    }
+    c->samples++;
+}
+
+static void cal_capture_send(const cal_capture_t *c) {
+    const float gyro_counts_per_dps = mpu6050_gyro_counts_per_dps(imu_config.gyro_range);
+
+    int spread = 0;
+    for (int i = 0; i < 3; i++) {
+        send_event(CODE_CAL_ACCEL_X + i, c->accel_sum[i] / c->samples);
+        if (c->accel_max[i] - c->accel_min[i] > spread)
+            spread = c->accel_max[i] - c->accel_min[i];
+    }
+    for (int i = 0; i < 3; i++)
+        send_event(CODE_CAL_GYRO_X + i, c->gyro_sum[i] / c->samples);
+    for (int i = 0; i < 3; i++) {
+        float angle = c->gyro_sum[i] * ((float)CAL_ANGLE_SCALE / (IMU_SAMPLE_RATE * gyro_counts_per_dps));
+        send_event(CODE_CAL_ANGLE_X + i, (int)fmaxf(fminf(roundf(angle), INT16_MAX), INT16_MIN));
+    }
+    send_event(CODE_CAL_SPREAD, spread > INT16_MAX ? INT16_MAX : spread);
+    send_event(CODE_CAL_GYRO_SCALE, (int)roundf(gyro_counts_per_dps * 10.0f));
+    send_event(CODE_CAL_ACCEL_SCALE, (int)mpu6050_accel_counts_per_g(imu_config.accel_range));
+    send_event(CODE_CAL_END, c->samples);
+}
+
+// Resumes from the kept snapshot unless the controller was moved while it
+// was down, in which case the normal initialisation runs
+static void ahrs_restore(FusionAhrs *ahrs, FusionVector accelerometer) {
+    FusionAhrsSnapshot snapshot;
+    if (!ahrs_snapshot_load(&snapshot))
+        return;
+    FusionAhrsRestoreSnapshot(ahrs, &snapshot);
+    const float g = FusionVectorMagnitude(accelerometer);
+    if (g < 0.5f || g > 1.5f)
+        return;
+    const float agreement = FusionVectorDotProduct(FusionAhrsGetGravity(ahrs), accelerometer) / g;
+    if (agreement < cosf(FusionDegreesToRadians(AHRS_RESTORE_MAX_ANGLE)))
+        FusionAhrsReset(ahrs);
+}
+
+static const uint8_t gesture_codes[] = {
+    [GESTURE_SHAKE] = CODE_GESTURE_SHAKE,
+    [GESTURE_PUNCH] = CODE_GESTURE_PUNCH,
+    [GESTURE_FLICK] = CODE_GESTURE_FLICK,
+};
+
+static int16_t imu_record_quantise(float value, float one) {
+    return (int16_t)fmaxf(fminf(roundf(value * one), INT16_MAX), INT16_MIN);
+}
+
+// Stores the sample while recording, then sends what was recorded as far
+// as the queue has room
+static void imu_record_step(imu_record_t *r, FusionVector gyroscope, FusionVector accelerometer) {
+    if (r->samples < r->total) {
+        for (int i = 0; i < 3; i++) {
+            r->data[r->samples][i] = imu_record_quantise(gyroscope.array[i], IMU_RECORD_GYRO_ONE);
+            r->data[r->samples][3 + i] = imu_record_quantise(accelerometer.array[i], IMU_RECORD_ACCEL_ONE);
+        }
+        r->samples++;
+        return;
+    }
+    while (r->total && uxQueueSpacesAvailable(xQueue) > IMU_RECORD_QUEUE_RESERVE) {
+        if (r->sent == r->total * 6) {
+            send_event(CODE_IMU_END, r->total);
+            r->total = 0;
+            break;
         }
+        send_event(CODE_IMU_GYRO_X + r->sent % 6, r->data[r->sent / 6][r->sent % 6]);
+        r->sent++;
     }
 }
 
 void mpu6050_task(void *p) {
-    int16_t accel[3], gyro[3], temp;
+    uint8_t burst[IMU_BURST_SIZE];
     bool left_active = false, right_active = false;
 
     i2c_init(i2c_default, 400000);
@@ -183,58 +518,161 @@ void mpu6050_task(void *p) {
     gpio_pull_up(I2C_SDA_GPIO);
     gpio_pull_up(I2C_SCL_GPIO);
 
-    mpu6050_reset();
-    vTaskDelay(pdMS_TO_TICKS(50));
+    mpu6050_status_t status;
+    while ((status = mpu6050_init(&imu_config)) != MPU6050_OK) {
+        printf("mpu6050: init failed (%d)\n", status);
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    const float gyro_counts_per_dps = mpu6050_gyro_counts_per_dps(imu_config.gyro_range);
+    const float accel_counts_per_g = mpu6050_accel_counts_per_g(imu_config.accel_range);
 
     FusionAhrs ahrs;
     FusionAhrsInitialise(&ahrs);
-
-    const float samplePeriod = 0.01f;
+    const FusionAhrsSettings settings = {
+            .convention = FusionConventionNwu,
+            .gain = AHRS_TUNING_GAIN,
+            .gyroscopeRange = mpu6050_gyro_range_dps(imu_config.gyro_range),
+            .accelerationRejection = AHRS_TUNING_ACCELERATION_REJECTION,
+            .magneticRejection = 90.0f,
+            .recoveryTriggerPeriod = AHRS_TUNING_RECOVERY_TRIGGER_PERIOD,
+    };
+    FusionAhrsSetSettings(&ahrs, &settings);
+
+    // Gyroscope offset: start from the one stored by the last run, refine it
+    // with the start-up calibration, then let FusionOffset track drift
+    FusionOffset offset;
+    FusionOffsetInitialise(&offset, IMU_SAMPLE_RATE);
+    FusionVector stored_offset = FUSION_VECTOR_ZERO;
+    if (flash_store_read(FLASH_STORE_GYRO_OFFSET, &stored_offset, sizeof(stored_offset)))
+        FusionOffsetSetOffset(&offset, stored_offset);
+
+    imu_decoder_t gyro_decoder, accel_decoder;
+    cal_capture_t capture = {0};
+    gesture_engine_t gestures;
+    gesture_init(&gestures);
+
+    FusionVector calibration_sum = FUSION_VECTOR_ZERO;
+    FusionVector calibration_min, calibration_max;
+    int calibration_samples = 0;
+    uint32_t save_countdown = GYRO_OFFSET_SAVE_PERIOD_S * IMU_SAMPLE_RATE;
+
+    const float samplePeriod = 1.0f / IMU_SAMPLE_RATE;
     FusionVector gyroscope, accelerometer;
+    bool restored = false;
 
     while (1) {
-        mpu6050_read_raw(accel, gyro, &temp);
+        if (!mpu6050_read_burst(burst)) {
+            vTaskDelay(pdMS_TO_TICKS(1000 / IMU_SAMPLE_RATE));
+            continue;
+        }
+
+        if (cal_changed) {
+            taskENTER_CRITICAL();
+            const imu_calibration_t cal = cal_pending;
+            cal_changed = false;
+            taskEXIT_CRITICAL();
+            imu_cal_applied_t applied;
+            imu_cal_prepare(&cal.gyroscope, gyro_counts_per_dps, &applied);
+            imu_decode_init(&gyro_decoder, IMU_BURST_GYRO, &applied.matrix, applied.offset, IMU_AXES_ALIGNMENT);
+            imu_cal_prepare(&cal.accelerometer, accel_counts_per_g, &applied);
+            imu_decode_init(&accel_decoder, IMU_BURST_ACCEL, &applied.matrix, applied.offset, IMU_AXES_ALIGNMENT);
+            // The calibration carries its own gyroscope offset; what was
+            // learned before applied to the old one
+            if (calibration_samples >= GYRO_CALIBRATION_SAMPLES) {
+                FusionOffsetSetOffset(&offset, FUSION_VECTOR_ZERO);
+                gyro_offset_save(FUSION_VECTOR_ZERO, &stored_offset);
+            }
+        }
+
+        if (capture.total == 0 && cal_capture_request) {
+            capture = (cal_capture_t){.total = cal_capture_request};
+            cal_capture_request = 0;
+        }
+        if (capture.total) {
+            int16_t accel[3], gyro[3];
+            imu_decode_raw(burst, IMU_BURST_ACCEL, accel);
+            imu_decode_raw(burst, IMU_BURST_GYRO, gyro);
+            cal_capture_add(&capture, accel, gyro);
+            if (capture.samples == capture.total) {
+                cal_capture_send(&capture);
+                capture.total = 0;
+            }
+        }
 
-        gyroscope.axis.x = gyro[0] / 131.0f;
-        gyroscope.axis.y = gyro[1] / 131.0f;
-        gyroscope.axis.z = gyro[2] / 131.0f;
+        gyroscope = imu_decode(&gyro_decoder, burst);
+        accelerometer = imu_decode(&accel_decoder, burst);
 
-        accelerometer.axis.x = accel[0] / 16384.0f;
-        accelerometer.axis.y = accel[1] / 16384.0f;
-        accelerometer.axis.z = accel[2] / 16384.0f;
+        if (calibration_samples < GYRO_CALIBRATION_SAMPLES) {
+            calibration_sum = FusionVectorAdd(calibration_sum, gyroscope);
+            for (int i = 0; i < 3; i++) {
+                if (calibration_samples == 0 || gyroscope.array[i] < calibration_min.array[i])
+                    calibration_min.array[i] = gyroscope.array[i];
+                if (calibration_samples == 0 || gyroscope.array[i] > calibration_max.array[i])
+                    calibration_max.array[i] = gyroscope.array[i];
+            }
+            if (++calibration_samples == GYRO_CALIBRATION_SAMPLES) {
+                const FusionVector spread = FusionVectorSubtract(calibration_max, calibration_min);
+                // Moved during start-up: keep the stored offset and let
+                // FusionOffset converge from there
+                if (spread.axis.x < GYRO_CALIBRATION_SPREAD && spread.axis.y < GYRO_CALIBRATION_SPREAD &&
+                    spread.axis.z < GYRO_CALIBRATION_SPREAD) {
+                    const FusionVector mean = FusionVectorMultiplyScalar(calibration_sum, 1.0f / GYRO_CALIBRATION_SAMPLES);
+                    FusionOffsetSetOffset(&offset, mean);
+                    gyro_offset_save(mean, &stored_offset);
+                }
+            }
+        } else if (--save_countdown == 0) {
+            save_countdown = GYRO_OFFSET_SAVE_PERIOD_S * IMU_SAMPLE_RATE;
+            gyro_offset_save(FusionOffsetGetOffset(&offset), &stored_offset);
+        }
 
+        gyroscope = FusionOffsetUpdate(&offset, gyroscope);
+
+        if (!restored) {
+            ahrs_restore(&ahrs, accelerometer);
+            restored = true;
+        }
         FusionAhrsUpdateNoMagnetometer(&ahrs, gyroscope, accelerometer, samplePeriod);
+        if (imu_record.total == 0 && imu_record_request) {
+            imu_record.total = imu_record_request;
+            imu_record.samples = imu_record.sent = 0;
+            imu_record_request = 0;
+        }
+        imu_record_step(&imu_record, gyroscope, accelerometer);
+        const FusionAhrsSnapshot snapshot = FusionAhrsGetSnapshot(&ahrs);
+        ahrs_snapshot_keep(&snapshot);
+        if (ahrs_save_request) {
+            ahrs_save_request = false;
+            send_event(CODE_AHRS_SAVED, ahrs_snapshot_save(&snapshot));
+        }
+
+        const gesture_t gesture = gesture_update(&gestures, FusionAhrsGetLinearAcceleration(&ahrs),
+                                                 FusionAhrsGetEarthAcceleration(&ahrs));
+        if (gesture != GESTURE_NONE)
+            send_event(gesture_codes[gesture], 1);
         FusionEuler angles = FusionQuaternionToEuler(FusionAhrsGetQuaternion(&ahrs));
         float roll = FusionRadiansToDegrees(angles.angle.roll);
 
-        btn_t evt;
-        if (roll < -1200.0f) {
-            evt.button = CODE_TILT_LEFT;
-            evt.value = 1;
-            xQueueSend(xQueue, &evt, 0);
+        const float enter = (float)tilt_enter, exit = (float)tilt_exit;
+        if (roll < -enter) {
+            send_event(CODE_TILT_LEFT, 1);
             left_active = true;
             right_active = false;
-        } else if (roll > 1200.0f) {
-            evt.button = CODE_TILT_RIGHT;
-            evt.value = 1;
-            xQueueSend(xQueue, &evt, 0);
+        } else if (roll > enter) {
+            send_event(CODE_TILT_RIGHT, 1);
             right_active = true;
             left_active = false;
-        } else if (roll >= -1000.0f && roll <= 1000.0f) {
+        } else if (roll >= -exit && roll <= exit) {
             if (left_active) {
-                evt.button = CODE_TILT_LEFT;
-                evt.value = 0;
-                xQueueSend(xQueue, &evt, 0);
+                send_event(CODE_TILT_LEFT, 0);
                 left_active = false;
             }
             if (right_active) {
-                evt.button = CODE_TILT_RIGHT;
-                evt.value = 0;
-                xQueueSend(xQueue, &evt, 0);
+                send_event(CODE_TILT_RIGHT, 0);
                 right_active = false;
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
+        vTaskDelay(pdMS_TO_TICKS(1000 / IMU_SAMPLE_RATE));
     }
 }
 
@@ -243,20 +681,36 @@ int main(void) {
     adc_init();
     adc_gpio_init(VRX);
     adc_gpio_init(VRY);
+    adc_gpio_init(BATTERY_ADC_GPIO);
     oled1_btn_led_init();
 
+#if TRIG_BENCH
+    sleep_ms(2000); // time to open the USB serial port
+    trig_bench_run();
+#endif
+
     gpio_set_irq_enabled_with_callback(BTN_HOME, GPIO_IRQ_EDGE_FALL|GPIO_IRQ_EDGE_RISE, true, &btn_callback);
     gpio_set_irq_enabled(BTN_A,    GPIO_IRQ_EDGE_FALL|GPIO_IRQ_EDGE_RISE, true);
     gpio_set_irq_enabled(BTN_B,    GPIO_IRQ_EDGE_FALL|GPIO_IRQ_EDGE_RISE, true);
     gpio_set_irq_enabled(BTN_1,    GPIO_IRQ_EDGE_FALL|GPIO_IRQ_EDGE_RISE, true);
     gpio_set_irq_enabled(BTN_2,    GPIO_IRQ_EDGE_FALL|GPIO_IRQ_EDGE_RISE, true);
 
+    imu_cal_load(&cal_pending);
+    cal_changed = true;
+
     xQueue = xQueueCreate(32, sizeof(btn_t));
+    xAdcSemaphore = xSemaphoreCreateBinary();
+    xSemaphoreGive(xAdcSemaphore);
+    xBuzzerTimer = xTimerCreate("buzzer", 1, pdFALSE, NULL, buzzer_off_callback);
     xTaskCreate(uart_task,    "uart", 2048, NULL, 1, NULL);
     xTaskCreate(x_task,       "adcX", 2048, NULL, 1, NULL);
     xTaskCreate(y_task,       "adcY", 2048, NULL, 1, NULL);
     xTaskCreate(mpu6050_task, "gyro", 2048, NULL, 1, NULL);
     xTaskCreate(hc06_state_task, "hc06_state", 512, NULL, 1, NULL);
+#if DISPLAY_ENABLED
+    if (display_init())
+        xTaskCreate(status_task, "status", 1024, NULL, DISPLAY_TASK_PRIORITY, NULL);
+#endif
 
 
     vTaskStartScheduler();
@@ -0,0 +1,76 @@
+#include "mpu6050.h"
+
+#include "hardware/i2c.h"
+
+#define MPU6050_I2C i2c_default
+#define MPU6050_I2C_TIMEOUT_US 2000
+
+static bool write_register(uint8_t reg, uint8_t value) {
+    uint8_t buf[] = { reg, value };
+    return i2c_write_timeout_us(MPU6050_I2C, MPU6050_I2C_DEFAULT, buf, 2, false,
+                                MPU6050_I2C_TIMEOUT_US) == 2;
+}
+
+static bool read_registers(uint8_t reg, uint8_t *data, size_t len) {
+    return i2c_write_timeout_us(MPU6050_I2C, MPU6050_I2C_DEFAULT, &reg, 1, true,
+                                MPU6050_I2C_TIMEOUT_US) == 1 &&
+           i2c_read_timeout_us(MPU6050_I2C, MPU6050_I2C_DEFAULT, data, len, false,
+                               MPU6050_I2C_TIMEOUT_US) == (int)len;
+}
+
+// Datasheet sensitivity per FS_SEL / AFS_SEL
+float mpu6050_gyro_counts_per_dps(mpu6050_gyro_range_t range) {
+    static const float counts[] = { 131.0f, 65.5f, 32.8f, 16.4f };
+    return counts[range & 3];
+}
+
+float mpu6050_gyro_range_dps(mpu6050_gyro_range_t range) {
+    return 250.0f * (1 << (range & 3));
+}
+
+float mpu6050_accel_counts_per_g(mpu6050_accel_range_t range) {
+    return 16384.0f / (1 << (range & 3));
+}
+
+// Ranges, DLPF and sample rate, each read back after writing
+mpu6050_status_t mpu6050_configure(const mpu6050_config_t *config) {
+    const uint32_t gyro_rate = config->dlpf == MPU6050_DLPF_260HZ ? 8000 : 1000;
+    if (config->sample_rate_hz == 0 || gyro_rate % config->sample_rate_hz ||
+        gyro_rate / config->sample_rate_hz > 256)
+        return MPU6050_ERR_RATE;
+
+    const uint8_t regs[][2] = {
+        { MPUREG_CONFIG, config->dlpf },
+        { MPUREG_SMPLRT_DIV, gyro_rate / config->sample_rate_hz - 1 },
+        { MPUREG_GYRO_CONFIG, config->gyro_range << 3 },
+        { MPUREG_ACCEL_CONFIG, config->accel_range << 3 },
+    };
+
+    for (size_t i = 0; i < sizeof(regs) / sizeof(regs[0]); i++) {
+        uint8_t value;
+        if (!write_register(regs[i][0], regs[i][1]) || !read_registers(regs[i][0], &value, 1))
+            return MPU6050_ERR_I2C;
+        if (value != regs[i][1])
+            return MPU6050_ERR_READBACK;
+    }
+    return MPU6050_OK;
+}
+
+// Wakes the sensor, checks it is an MPU-6050 and applies the configuration
+mpu6050_status_t mpu6050_init(const mpu6050_config_t *config) {
+    uint8_t whoami;
+
+    if (!read_registers(MPUREG_WHOAMI, &whoami, 1))
+        return MPU6050_ERR_I2C;
+    if ((whoami & 0x7E) != MPU6050_WHOAMI_VALUE)
+        return MPU6050_ERR_WHOAMI;
+    if (!write_register(MPUREG_PWR_MGMT_1, MPU6050_PWR_MGMT_1_CLK_PLL_X))
+        return MPU6050_ERR_I2C;
+    return mpu6050_configure(config);
+}
+
+// Accelerometer, temperature and gyroscope in one transaction, so the
+// three come from the same sample
+bool mpu6050_read_burst(uint8_t burst[MPU6050_BURST_SIZE]) {
+    return read_registers(MPUREG_ACCEL_XOUT_H, burst, MPU6050_BURST_SIZE);
+}
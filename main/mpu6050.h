@@ -35,4 +35,60 @@
 #define MPUREG_FIFO_R_W 0x74
 #define MPUREG_PRODUCT_ID 0x0C // Product ID Register
 
+#define MPU6050_WHOAMI_VALUE 0x68
+#define MPU6050_PWR_MGMT_1_CLK_PLL_X 0x01 // wake up, clock from the X gyro PLL
+#define MPU6050_BURST_SIZE 14             // ACCEL_XOUT_H .. GYRO_ZOUT_L
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Full-scale ranges and low-pass settings, as written to the registers
+typedef enum {
+    MPU6050_GYRO_250DPS = 0,
+    MPU6050_GYRO_500DPS = 1,
+    MPU6050_GYRO_1000DPS = 2,
+    MPU6050_GYRO_2000DPS = 3,
+} mpu6050_gyro_range_t;
+
+typedef enum {
+    MPU6050_ACCEL_2G = 0,
+    MPU6050_ACCEL_4G = 1,
+    MPU6050_ACCEL_8G = 2,
+    MPU6050_ACCEL_16G = 3,
+} mpu6050_accel_range_t;
+
+// Accelerometer / gyroscope bandwidth of the digital low-pass filter
+typedef enum {
+    MPU6050_DLPF_260HZ = 0, // off: gyroscope output rate 8 kHz
+    MPU6050_DLPF_184HZ = 1,
+    MPU6050_DLPF_94HZ = 2,
+    MPU6050_DLPF_44HZ = 3,
+    MPU6050_DLPF_21HZ = 4,
+    MPU6050_DLPF_10HZ = 5,
+    MPU6050_DLPF_5HZ = 6,
+} mpu6050_dlpf_t;
+
+typedef struct {
+    mpu6050_gyro_range_t gyro_range;
+    mpu6050_accel_range_t accel_range;
+    mpu6050_dlpf_t dlpf;
+    uint16_t sample_rate_hz; // output data rate, gyroscope rate / (1 + SMPLRT_DIV)
+} mpu6050_config_t;
+
+typedef enum {
+    MPU6050_OK = 0,
+    MPU6050_ERR_I2C,      // no answer on the bus
+    MPU6050_ERR_WHOAMI,   // something else answers at the address
+    MPU6050_ERR_RATE,     // sample rate not reachable with this DLPF setting
+    MPU6050_ERR_READBACK, // a register did not keep the value written
+} mpu6050_status_t;
+
+mpu6050_status_t mpu6050_init(const mpu6050_config_t *config);
+mpu6050_status_t mpu6050_configure(const mpu6050_config_t *config);
+bool mpu6050_read_burst(uint8_t burst[MPU6050_BURST_SIZE]);
+
+float mpu6050_gyro_counts_per_dps(mpu6050_gyro_range_t range);
+float mpu6050_gyro_range_dps(mpu6050_gyro_range_t range);
+float mpu6050_accel_counts_per_g(mpu6050_accel_range_t range);
+
 #endif // __MPU6000_H__
\ No newline at end of file
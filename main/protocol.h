@@ -0,0 +1,92 @@
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+// Both directions use the same 4-byte frame:
+//     [code, value_lsb, value_msb, FRAME_END]
+// with value as a little-endian int16.
+#define FRAME_SIZE 4
+#define FRAME_END  0xFF
+
+// Controller -> host
+#define CODE_AXIS_X      0
+#define CODE_AXIS_Y      1
+#define CODE_BTN_HOME    2
+#define CODE_BTN_A       3
+#define CODE_BTN_B       4
+#define CODE_BTN_1       5
+#define CODE_BTN_2       6
+#define CODE_TILT_LEFT   8
+#define CODE_TILT_RIGHT  9
+#define CODE_GESTURE_SHAKE 10 // gesture.h, value 1 when recognised
+#define CODE_GESTURE_PUNCH 11
+#define CODE_GESTURE_FLICK 12
+
+// Reply to CMD_STATS_DUMP, one frame per counter (value is the counter
+// modulo 2^16), terminated by CODE_STAT_END.
+#define CODE_STAT_UPTIME_S     0x20
+#define CODE_STAT_EVENTS_SENT  0x21
+#define CODE_STAT_QUEUE_DROPS  0x22
+#define CODE_STAT_RX_FRAMES    0x23
+#define CODE_STAT_RX_ERRORS    0x24
+#define CODE_STAT_RX_OVERFLOWS 0x25
+#define CODE_STAT_DISPLAY_FPS         0x26 // only with the display built in
+#define CODE_STAT_DISPLAY_FLUSH_US    0x27 // longest flush so far, us (saturates at 32767)
+#define CODE_STAT_DISPLAY_DROPS       0x28 // presents refused (busy or rate limit)
+#define CODE_STAT_DISPLAY_OVER_BUDGET 0x29
+#define CODE_STAT_END          0x2F
+
+// Reply to CMD_CAL_CAPTURE, averages over the captured samples in raw
+// sensor counts, terminated by CODE_CAL_END.
+#define CODE_CAL_ACCEL_X 0x30
+#define CODE_CAL_ACCEL_Y 0x31
+#define CODE_CAL_ACCEL_Z 0x32
+#define CODE_CAL_GYRO_X  0x33
+#define CODE_CAL_GYRO_Y  0x34
+#define CODE_CAL_GYRO_Z  0x35
+#define CODE_CAL_ANGLE_X 0x36 // gyroscope integrated over the capture, in
+#define CODE_CAL_ANGLE_Y 0x37 // nominal degrees * CAL_ANGLE_SCALE
+#define CODE_CAL_ANGLE_Z 0x38
+#define CODE_CAL_SPREAD  0x39 // largest max - min of an accelerometer axis
+#define CODE_CAL_SAVED   0x3A // reply to CMD_CAL_COMMIT: 1 stored, 0 flash error,
+                             // -1 upload rejected (check mismatch)
+#define CODE_CAL_GYRO_SCALE  0x3B // counts per deg/s * 10 at the configured range
+#define CODE_CAL_ACCEL_SCALE 0x3C // counts per g at the configured range
+#define CODE_CAL_END     0x3F
+
+#define CAL_ANGLE_SCALE 32
+
+#define CODE_AHRS_SAVED 0x40 // reply to CMD_AHRS_SAVE: 1 stored, 0 flash error
+
+// Reply to CMD_IMU_RECORD: the gyroscope and accelerometer samples fed to
+// the AHRS, in order, six frames per sample (gyroscope in deg/s *
+// IMU_RECORD_GYRO_ONE, accelerometer in g * IMU_RECORD_ACCEL_ONE, one
+// sample per IMU_SAMPLE_RATE period), terminated by CODE_IMU_END with the
+// sample count. Sent at the pace the link allows, between live events.
+#define CODE_IMU_GYRO_X  0x50
+#define CODE_IMU_GYRO_Y  0x51
+#define CODE_IMU_GYRO_Z  0x52
+#define CODE_IMU_ACCEL_X 0x53
+#define CODE_IMU_ACCEL_Y 0x54
+#define CODE_IMU_ACCEL_Z 0x55
+#define CODE_IMU_END     0x5F
+
+#define IMU_RECORD_GYRO_ONE  16
+#define IMU_RECORD_ACCEL_ONE 4096
+
+// Host -> controller
+#define CMD_SET_REPORT_RATE 0x01 // joystick report rate in Hz, capped at the tick rate
+#define CMD_SET_DEADZONE    0x02 // joystick deadzone, in scaled units (0..255)
+#define CMD_SET_TILT_ENTER  0x03 // roll threshold that starts a tilt (>= exit)
+#define CMD_SET_TILT_EXIT   0x04 // roll threshold that releases a tilt (0..enter)
+#define CMD_BUZZER          0x05 // beep for value ms (0 stops)
+#define CMD_LED             0x06 // START_LED on (1) / off (0)
+#define CMD_STATS_DUMP      0x07 // reply with the CODE_STAT_* frames
+#define CMD_CAL_CAPTURE     0x08 // capture value IMU samples, reply with CODE_CAL_*
+#define CMD_CAL_INDEX       0x09 // select a calibration parameter (imu_cal.h)
+#define CMD_CAL_VALUE       0x0A // set the selected parameter and select the next
+#define CMD_CAL_COMMIT      0x0B // imu_cal_params_check of the parameters sent:
+                                 // apply and store them; 0: defaults
+#define CMD_AHRS_SAVE       0x0C // store the orientation for the next power-up
+#define CMD_IMU_RECORD      0x0D // record value IMU samples, reply with CODE_IMU_*
+
+#endif // PROTOCOL_H_
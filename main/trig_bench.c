@@ -0,0 +1,62 @@
+#include "trig_bench.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Fusion.h"
+#include "hardware/clocks.h"
+#include "pico/stdlib.h"
+
+#define TRIG_BENCH_CALLS 1000
+
+// Inputs read through a volatile pointer so the calls are not folded
+static float inputs[TRIG_BENCH_CALLS];
+static volatile float sink;
+
+// FusionQuaternionToEuler with either function set, as in fusion_trig_check
+static float euler_sum(const FusionQuaternion quaternion, const bool fast) {
+#define Q quaternion.element
+    const float halfMinusQySquared = 0.5f - Q.y * Q.y;
+    const float sinPitch = fminf(fmaxf(2.0f * (Q.w * Q.y - Q.z * Q.x), -1.0f), 1.0f);
+    if (fast) {
+        return FusionFastAtan2(Q.w * Q.x + Q.y * Q.z, halfMinusQySquared - Q.x * Q.x) +
+               FusionFastAsin(sinPitch) +
+               FusionFastAtan2(Q.w * Q.z + Q.x * Q.y, halfMinusQySquared - Q.z * Q.z);
+    }
+    return atan2f(Q.w * Q.x + Q.y * Q.z, halfMinusQySquared - Q.x * Q.x) +
+           asinf(sinPitch) +
+           atan2f(Q.w * Q.z + Q.x * Q.y, halfMinusQySquared - Q.z * Q.z);
+#undef Q
+}
+
+static void report(const char *label, uint32_t start_us) {
+    const uint32_t us = time_us_32() - start_us;
+    const float cycles = (float)us * (clock_get_hz(clk_sys) / 1e6f) / TRIG_BENCH_CALLS;
+    printf("trig_bench: %-16s %7.0f cycles/call\n", label, cycles);
+}
+
+#define TIME(label, expression)                           \
+    do {                                                  \
+        const volatile float *in = inputs;                \
+        float sum = 0.0f;                                 \
+        const uint32_t start = time_us_32();              \
+        for (int i = 0; i < TRIG_BENCH_CALLS; i++)        \
+            sum += (expression);                          \
+        report(label, start);                             \
+        sink = sum;                                       \
+    } while (0)
+
+void trig_bench_run(void) {
+    uint32_t seed = 1;
+    for (int i = 0; i < TRIG_BENCH_CALLS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        inputs[i] = ((seed >> 8) & 0xFFFFFF) / (float)0x800000 - 1.0f; // -1 to 1
+    }
+
+    TIME("atan2f", atan2f(in[i], 0.5f));
+    TIME("FusionFastAtan2", FusionFastAtan2(in[i], 0.5f));
+    TIME("asinf", asinf(in[i]));
+    TIME("FusionFastAsin", FusionFastAsin(in[i]));
+    TIME("euler (libm)", euler_sum(FusionQuaternionNormalise((FusionQuaternion){.element = {0.5f, in[i], in[(i + 1) % TRIG_BENCH_CALLS], 0.25f}}), false));
+    TIME("euler (fast)", euler_sum(FusionQuaternionNormalise((FusionQuaternion){.element = {0.5f, in[i], in[(i + 1) % TRIG_BENCH_CALLS], 0.25f}}), true));
+}
@@ -0,0 +1,10 @@
+#ifndef TRIG_BENCH_H_
+#define TRIG_BENCH_H_
+
+// Times atan2f/asinf against FusionFastAtan2/FusionFastAsin and
+// FusionQuaternionToEuler built with each on the target and prints the
+// cycles per call over stdio. Built with -DPICO_EMB_TRIG_BENCH=ON; runs
+// once at boot, before the scheduler starts.
+void trig_bench_run(void);
+
+#endif
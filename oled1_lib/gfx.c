@@ -1,18 +1,121 @@
 #include "gfx.h"
 #include "font.h"
+#include "glyph_cache.h"
+
+// Extra bytes a separate span costs over one longer transfer (window
+// commands plus the D/C and DMA setup)
+#define GFX_SPAN_OVERHEAD 16
 
 inline static void swap(int32_t *a, int32_t *b) {
-    int32_t *t = a;
+    int32_t t = *a;
     *a = *b;
-    *b = *t;
+    *b = t;
 }
 
-char gfx_init(ssd1306_t *p, uint16_t width, uint16_t height) {
+inline static void mark_dirty(ssd1306_t *p, uint32_t page, uint32_t x) {
+    if (p->dirty_min[page] == GFX_CLEAN || x < p->dirty_min[page])
+        p->dirty_min[page] = x;
+    if (x > p->dirty_max[page])
+        p->dirty_max[page] = x;
+}
+
+// Sets (or clears) the bits of mask in one framebuffer byte
+inline static void write_bits(ssd1306_t *p, uint32_t page, uint32_t x,
+                              uint8_t mask, bool set) {
+    uint8_t *b = &p->buffer[x + GFX_WIDTH(p) * page];
+    uint8_t v = set ? (*b | mask) : (*b & ~mask);
+    if (v != *b) {
+        *b = v;
+        mark_dirty(p, page, x);
+    }
+}
+
+// Page-aligned rectangle fill: one masked byte per column and page instead
+// of one read-modify-write per pixel
+static void fill_rect(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width,
+                      uint32_t height, bool set) {
+    if (x >= GFX_WIDTH(p) || y >= GFX_HEIGHT(p) || width == 0 || height == 0)
+        return;
+    if (width > GFX_WIDTH(p) - x)
+        width = GFX_WIDTH(p) - x;
+    if (height > GFX_HEIGHT(p) - y)
+        height = GFX_HEIGHT(p) - y;
+
+    uint32_t y_end = y + height; // exclusive
+    for (uint32_t page = y >> 3; page <= (y_end - 1) >> 3; page++) {
+        uint32_t top = page << 3;
+        uint8_t mask = 0xFF;
+        if (y > top)
+            mask &= 0xFF << (y - top);
+        if (y_end < top + 8)
+            mask &= 0xFF >> (top + 8 - y_end);
+
+        for (uint32_t i = x; i < x + width; i++)
+            write_bits(p, page, i, mask, set);
+    }
+}
+
+void gfx_mark_clean(ssd1306_t *p) {
+    memset(p->dirty_min, GFX_CLEAN, sizeof(p->dirty_min));
+    memset(p->dirty_max, 0, sizeof(p->dirty_max));
+}
+
+// Marks the whole buffer for the next gfx_show, e.g. after the panel was
+// reset or written by someone else.
+void gfx_mark_dirty(ssd1306_t *p) {
+    for (uint8_t page = 0; page < GFX_PAGES(p); page++) {
+        p->dirty_min[page] = 0;
+        p->dirty_max[page] = GFX_WIDTH(p) - 1;
+    }
+}
+
+bool gfx_is_dirty(const ssd1306_t *p) {
+    for (uint8_t page = 0; page < GFX_PAGES(p); page++)
+        if (p->dirty_min[page] != GFX_CLEAN)
+            return true;
+    return false;
+}
+
+// Copies the dirty spans of src into dst (same geometry), moving the dirty
+// marks along so the next gfx_show(dst) sends them. src ends up clean.
+void gfx_copy_dirty(ssd1306_t *dst, ssd1306_t *src) {
+    for (uint8_t page = 0; page < GFX_PAGES(src); page++) {
+        uint8_t min = src->dirty_min[page], max = src->dirty_max[page];
+        if (min == GFX_CLEAN)
+            continue;
+        memcpy(dst->buffer + page * GFX_WIDTH(dst) + min,
+               src->buffer + page * GFX_WIDTH(src) + min, max - min + 1);
+        mark_dirty(dst, page, min);
+        mark_dirty(dst, page, max);
+    }
+    gfx_mark_clean(src);
+}
+
+static char gfx_set_geometry(ssd1306_t *p, uint16_t width, uint16_t height) {
     p->width = width;
     p->height = height;
     p->pages = height / 8;
     p->bufsize = (p->pages) * (p->width);
 
+    if (p->pages > GFX_MAX_PAGES) {
+        p->bufsize = 0;
+        return false;
+    }
+
+#ifdef GFX_FIXED_GEOMETRY
+    if (width != GFX_MONO_LCD_WIDTH || height != GFX_MONO_LCD_HEIGHT) {
+        p->bufsize = 0;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+char gfx_init(ssd1306_t *p, uint16_t width, uint16_t height) {
+    if (!gfx_set_geometry(p, width, height))
+        return false;
+
     // trocar remover malloc por alocação estática
     if ((p->buffer = malloc(p->bufsize + 1)) == NULL) {
         p->bufsize = 0;
@@ -23,30 +126,73 @@ char gfx_init(ssd1306_t *p, uint16_t width, uint16_t height) {
 
     ++(p->buffer);
 
+    gfx_mark_clean(p);
+    gfx_mark_dirty(p);
+
+    return true;
+}
+
+// Same as gfx_init but draws into a caller-owned buffer of at least
+// (height / 8) * width bytes, e.g. one declared with GFX_FRAMEBUFFER.
+// No heap is used; do not call gfx_deinit on it.
+char gfx_init_with_buffer(ssd1306_t *p, uint16_t width, uint16_t height,
+                          uint8_t *buffer) {
+    if (!gfx_set_geometry(p, width, height))
+        return false;
+
+    p->buffer = buffer;
+    memset(p->buffer, 0, p->bufsize);
+
+    gfx_mark_clean(p);
+    gfx_mark_dirty(p);
+
     return true;
 }
 
 inline void gfx_deinit(ssd1306_t *p) { free(p->buffer - 1); }
 
+// Only columns that were not already blank become dirty
 void gfx_clear_buffer(ssd1306_t *p) {
-    memset(p->buffer, 0, p->bufsize + 1);
+    for (uint8_t page = 0; page < GFX_PAGES(p); page++) {
+        uint8_t *row = p->buffer + page * GFX_WIDTH(p);
+        uint32_t first = 0, last = GFX_WIDTH(p);
+
+        while (first < GFX_WIDTH(p) && row[first] == 0)
+            first++;
+        if (first == GFX_WIDTH(p))
+            continue;
+        while (row[last - 1] == 0)
+            last--;
+
+        mark_dirty(p, page, first);
+        mark_dirty(p, page, last - 1);
+        memset(row + first, 0, last - first);
+    }
 }
 
 void gfx_clear_pixel(ssd1306_t *p, uint32_t x, uint32_t y) {
-    if (x >= p->width || y >= p->height)
+    if (x >= GFX_WIDTH(p) || y >= GFX_HEIGHT(p))
         return;
 
-    p->buffer[x + p->width * (y >> 3)] &= ~(0x1 << (y & 0x07));
+    write_bits(p, y >> 3, x, 0x1 << (y & 0x07), false);
 }
 
 void gfx_draw_pixel(ssd1306_t *p, uint32_t x, uint32_t y) {
-    if (x >= p->width || y >= p->height)
+    if (x >= GFX_WIDTH(p) || y >= GFX_HEIGHT(p))
         return;
 
-    p->buffer[x + p->width * (y >> 3)] |=
-        0x1 << (y & 0x07); // y>>3==y/8 && y&0x7==y%8
+    write_bits(p, y >> 3, x, 0x1 << (y & 0x07), true); // y>>3==y/8 && y&0x7==y%8
+}
+
+void gfx_draw_hline(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width) {
+    fill_rect(p, x, y, width, 1, true);
+}
+
+void gfx_draw_vline(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t height) {
+    fill_rect(p, x, y, 1, height, true);
 }
 
+// Integer Bresenham; straight lines go through the span fills
 void gfx_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2,
                    int32_t y2) {
     if (x1 > x2) {
@@ -54,27 +200,50 @@ void gfx_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2,
         swap(&y1, &y2);
     }
 
+    if (y1 == y2) {
+        if (y1 >= 0 && x2 >= 0)
+            gfx_draw_hline(p, x1 < 0 ? 0 : x1, y1, x2 - (x1 < 0 ? 0 : x1) + 1);
+        return;
+    }
+
     if (x1 == x2) {
         if (y1 > y2)
             swap(&y1, &y2);
-        for (int32_t i = y1; i <= y2; ++i)
-            gfx_draw_pixel(p, x1, i);
+        if (x1 >= 0 && y2 >= 0)
+            gfx_draw_vline(p, x1, y1 < 0 ? 0 : y1, y2 - (y1 < 0 ? 0 : y1) + 1);
         return;
     }
 
-    float m = (float)(y2 - y1) / (float)(x2 - x1);
+    int32_t dx = x2 - x1;
+    int32_t dy = y2 > y1 ? y2 - y1 : y1 - y2;
+    int32_t sy = y2 > y1 ? 1 : -1;
+    int32_t err = dx - dy;
 
-    for (int32_t i = x1; i <= x2; ++i) {
-        float y = m * (float)(i - x1) + (float)y1;
-        gfx_draw_pixel(p, i, (uint32_t)y);
+    while (1) {
+        if (x1 >= 0 && y1 >= 0)
+            gfx_draw_pixel(p, x1, y1);
+        if (x1 == x2 && y1 == y2)
+            break;
+        int32_t e2 = 2 * err;
+        if (e2 > -dy) {
+            err -= dy;
+            x1++;
+        }
+        if (e2 < dx) {
+            err += dx;
+            y1 += sy;
+        }
     }
 }
 
 void gfx_draw_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width,
                      uint32_t height) {
-    for (uint32_t i = 0; i < width; ++i)
-        for (uint32_t j = 0; j < height; ++j)
-            gfx_draw_pixel(p, x + i, y + j);
+    fill_rect(p, x, y, width, height, true);
+}
+
+void gfx_clear_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width,
+                      uint32_t height) {
+    fill_rect(p, x, y, width, height, false);
 }
 
 void gfx_draw_empty_square(ssd1306_t *p, uint32_t x, uint32_t y,
@@ -85,11 +254,39 @@ void gfx_draw_empty_square(ssd1306_t *p, uint32_t x, uint32_t y,
     gfx_draw_line(p, x + width, y, x + width, y + height);
 }
 
+// ORs one 8-pixel font column into the (up to) two pages it straddles
+static void blit_column(ssd1306_t *p, uint32_t x, uint32_t y, uint8_t bits) {
+    if (x >= GFX_WIDTH(p) || y >= GFX_HEIGHT(p) || bits == 0)
+        return;
+
+    uint32_t page = y >> 3, shift = y & 0x07;
+    write_bits(p, page, x, bits << shift, true);
+    if (shift && page + 1 < GFX_PAGES(p))
+        write_bits(p, page + 1, x, bits >> (8 - shift), true);
+}
+
+// ORs a block of page-major column bytes (pages rows of width bytes) into
+// the framebuffer at any y
+void gfx_blit_columns(ssd1306_t *p, uint32_t x, uint32_t y,
+                      const uint8_t *data, uint32_t width, uint32_t pages) {
+    for (uint32_t page = 0; page < pages; page++)
+        for (uint32_t col = 0; col < width; col++)
+            blit_column(p, x + col, y + (page << 3), data[page * width + col]);
+}
+
 void gfx_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y,
                              uint32_t scale, const uint8_t *font, char c) {
     if (c < font[3] || c > font[4])
         return;
 
+    if (scale > 1) {
+        const glyph_t *g = glyph_cache_get(font, c, scale);
+        if (g) {
+            gfx_blit_columns(p, x, y, g->data, g->width, g->pages);
+            return;
+        }
+    }
+
     uint32_t parts_per_line = (font[0] >> 3) + ((font[0] & 7) > 0);
     for (uint8_t w = 0; w < font[1]; ++w) { // width
         uint32_t pp =
@@ -97,10 +294,17 @@ void gfx_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y,
         for (uint32_t lp = 0; lp < parts_per_line; ++lp) {
             uint8_t line = font[pp];
 
+            // Font data is column-major, so unscaled glyphs go in byte-wise
+            if (scale == 1) {
+                blit_column(p, x + w, y + (lp << 3), line);
+                ++pp;
+                continue;
+            }
+
             for (int8_t j = 0; j < 8; ++j, line >>= 1) {
                 if (line & 1)
-                    gfx_draw_square(p, x + w * scale, y + ((lp << 3) + j) * scale,
-                                    scale, scale);
+                    fill_rect(p, x + w * scale, y + ((lp << 3) + j) * scale,
+                              scale, scale, true);
             }
 
             ++pp;
@@ -126,10 +330,53 @@ void gfx_draw_string(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale,
     gfx_draw_string_with_font(p, x, y, scale, font_8x5, s);
 }
 
-void gfx_show(ssd1306_t *p) {
-    for (uint8_t page = 0; page < p->pages; page++) {
-        ssd1306_set_page_address(page);
-        ssd1306_set_column_address(0);
-        ssd1306_put_page(p->buffer + (page * p->width), page, 0, p->width);
+// Sends the parts of the framebuffer changed since the last show and returns
+// as soon as the last transfer is started. Dirty pages are either sent as
+// full rows in one transfer or, when that would resend much more than what
+// changed, as one column span per page. The buffer must not change until
+// callback runs (interrupt context) or ssd1306_dma_busy() returns false.
+void gfx_show_async(ssd1306_t *p, ssd1306_dma_callback_t callback, void *ctx) {
+    uint32_t first = GFX_MAX_PAGES, last = 0, spans = 0, span_bytes = 0;
+
+    for (uint32_t page = 0; page < GFX_PAGES(p); page++) {
+        if (p->dirty_min[page] == GFX_CLEAN)
+            continue;
+        if (first == GFX_MAX_PAGES)
+            first = page;
+        last = page;
+        spans++;
+        span_bytes += p->dirty_max[page] - p->dirty_min[page] + 1;
     }
+
+    if (spans == 0) {
+        if (callback)
+            callback(ctx);
+        return;
+    }
+
+    uint32_t rows_bytes = (last - first + 1) * GFX_WIDTH(p);
+    if (spans == 1 ||
+        rows_bytes > span_bytes + (spans - 1) * GFX_SPAN_OVERHEAD) {
+        for (uint32_t page = first; page <= last; page++) {
+            uint8_t min = p->dirty_min[page], max = p->dirty_max[page];
+            if (min == GFX_CLEAN)
+                continue;
+            bool final = page == last;
+            ssd1306_set_window(min, max, page, page);
+            ssd1306_write_data_dma(p->buffer + page * GFX_WIDTH(p) + min,
+                                   max - min + 1, final ? callback : NULL,
+                                   final ? ctx : NULL);
+        }
+    } else {
+        ssd1306_set_window(0, GFX_WIDTH(p) - 1, first, last);
+        ssd1306_write_data_dma(p->buffer + first * GFX_WIDTH(p), rows_bytes,
+                               callback, ctx);
+    }
+
+    gfx_mark_clean(p);
+}
+
+void gfx_show(ssd1306_t *p) {
+    gfx_show_async(p, NULL, NULL);
+    ssd1306_dma_wait();
 }
@@ -4,6 +4,9 @@
 #include "ssd1306.h"
 #include <string.h>
 
+#define GFX_MAX_PAGES 8
+#define GFX_CLEAN 0xFF /**< dirty_min value of a page with nothing to send */
+
 typedef struct {
     uint8_t width;     /**< width of display */
     uint8_t height;    /**< height of display */
@@ -11,14 +14,55 @@ typedef struct {
     bool external_vcc; /**< whether display uses external vcc */
     uint8_t *buffer;   /**< display buffer */
     size_t bufsize;    /**< buffer size */
+    uint8_t dirty_min[GFX_MAX_PAGES]; /**< first changed column per page */
+    uint8_t dirty_max[GFX_MAX_PAGES]; /**< last changed column per page */
 } ssd1306_t;
 
+// With GFX_FIXED_GEOMETRY the primitives use the GFX_MONO_LCD_* constants
+// instead of the fields above, so index math folds into shifts and the
+// bounds checks into immediates. gfx_init then only accepts that size.
+#ifdef GFX_FIXED_GEOMETRY
+#define GFX_WIDTH(p) GFX_MONO_LCD_WIDTH
+#define GFX_HEIGHT(p) GFX_MONO_LCD_HEIGHT
+#define GFX_PAGES(p) GFX_MONO_LCD_PAGES
+#else
+#define GFX_WIDTH(p) ((p)->width)
+#define GFX_HEIGHT(p) ((p)->height)
+#define GFX_PAGES(p) ((p)->pages)
+#endif
+
+// Statically allocated framebuffer for gfx_init_with_buffer
+#define GFX_FRAMEBUFFER(name, width, height) \
+    static uint8_t name[((height) / 8) * (width)]
+
 char gfx_init(ssd1306_t *p, uint16_t width, uint16_t height);
+char gfx_init_with_buffer(ssd1306_t *p, uint16_t width, uint16_t height,
+                          uint8_t *buffer);
 void gfx_clear_buffer(ssd1306_t *p);
 void gfx_show(ssd1306_t *p);
+void gfx_show_async(ssd1306_t *p, ssd1306_dma_callback_t callback, void *ctx);
 void gfx_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2,
                    int32_t y2);
 void gfx_draw_pixel(ssd1306_t *p, uint32_t x, uint32_t y);
+void gfx_clear_pixel(ssd1306_t *p, uint32_t x, uint32_t y);
+void gfx_draw_hline(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width);
+void gfx_draw_vline(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t height);
+void gfx_draw_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width,
+                     uint32_t height);
+void gfx_draw_empty_square(ssd1306_t *p, uint32_t x, uint32_t y,
+                           uint32_t width, uint32_t height);
+void gfx_clear_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width,
+                      uint32_t height);
+void gfx_mark_dirty(ssd1306_t *p);
+void gfx_mark_clean(ssd1306_t *p);
+bool gfx_is_dirty(const ssd1306_t *p);
+void gfx_copy_dirty(ssd1306_t *dst, ssd1306_t *src);
+void gfx_blit_columns(ssd1306_t *p, uint32_t x, uint32_t y,
+                      const uint8_t *data, uint32_t width, uint32_t pages);
+void gfx_draw_char(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale,
+                   char c);
+void gfx_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y,
+                             uint32_t scale, const uint8_t *font, char c);
 void gfx_draw_string(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale,
                      const char *s);
 void gfx_draw_string_with_font(ssd1306_t *p, uint32_t x, uint32_t y,
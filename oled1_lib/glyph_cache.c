@@ -0,0 +1,72 @@
+#include "glyph_cache.h"
+#include <string.h>
+
+static glyph_t cache[GLYPH_CACHE_ENTRIES];
+static uint32_t use_clock;
+static glyph_cache_stats_t stats;
+
+static void render(glyph_t *g) {
+    const uint8_t *font = g->font;
+    uint32_t scale = g->scale;
+    uint32_t parts_per_line = (font[0] >> 3) + ((font[0] & 7) > 0);
+    uint32_t pp = (g->c - font[3]) * font[1] * parts_per_line + 5;
+
+    memset(g->data, 0, g->width * g->pages);
+    for (uint32_t w = 0; w < font[1]; ++w) {
+        for (uint32_t lp = 0; lp < parts_per_line; ++lp, ++pp) {
+            uint8_t line = font[pp];
+            for (uint32_t j = 0; j < 8; ++j, line >>= 1) {
+                if (!(line & 1))
+                    continue;
+                // One source pixel becomes a scale x scale block
+                for (uint32_t r = ((lp << 3) + j) * scale;
+                     r < ((lp << 3) + j + 1) * scale; r++)
+                    for (uint32_t col = w * scale; col < (w + 1) * scale; col++)
+                        g->data[(r >> 3) * g->width + col] |= 1 << (r & 7);
+            }
+        }
+    }
+}
+
+// Returns NULL when the character is outside the font or the scaled glyph
+// does not fit in GLYPH_CACHE_MAX_BYTES; callers then draw it directly.
+const glyph_t *glyph_cache_get(const uint8_t *font, char c, uint32_t scale) {
+    if (c < font[3] || c > font[4] || scale == 0)
+        return NULL;
+
+    uint32_t width = font[1] * scale;
+    uint32_t pages = (font[0] * scale + 7) >> 3;
+    if (width > 0xFF || width * pages > GLYPH_CACHE_MAX_BYTES)
+        return NULL;
+
+    glyph_t *victim = &cache[0];
+    for (uint32_t i = 0; i < GLYPH_CACHE_ENTRIES; i++) {
+        glyph_t *g = &cache[i];
+        if (g->font == font && g->c == c && g->scale == scale) {
+            g->last_use = ++use_clock;
+            stats.hits++;
+            return g;
+        }
+        if (g->last_use < victim->last_use)
+            victim = g;
+    }
+
+    stats.misses++;
+    victim->font = font;
+    victim->c = c;
+    victim->scale = scale;
+    victim->width = width;
+    victim->pages = pages;
+    victim->last_use = ++use_clock;
+    render(victim);
+    return victim;
+}
+
+void glyph_cache_clear(void) {
+    memset(cache, 0, sizeof(cache));
+    use_clock = 0;
+}
+
+void glyph_cache_get_stats(glyph_cache_stats_t *s) {
+    *s = stats;
+}
@@ -0,0 +1,37 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdint.h>
+
+// Scaled glyphs are expanded once into page-aligned column bytes and kept in
+// a small LRU, so redrawing text at scale > 1 only ORs columns into the
+// framebuffer. Not thread safe: draw from one task.
+
+#ifndef GLYPH_CACHE_ENTRIES
+#define GLYPH_CACHE_ENTRIES 16
+#endif
+
+#ifndef GLYPH_CACHE_MAX_BYTES
+#define GLYPH_CACHE_MAX_BYTES 80 // font_8x5 up to scale 4 (20 columns, 4 pages)
+#endif
+
+typedef struct {
+    const uint8_t *font; /**< font table the glyph came from, NULL if unused */
+    char c;
+    uint8_t scale;
+    uint8_t width;       /**< columns */
+    uint8_t pages;       /**< 8-pixel rows, data is page-major */
+    uint32_t last_use;
+    uint8_t data[GLYPH_CACHE_MAX_BYTES];
+} glyph_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+} glyph_cache_stats_t;
+
+const glyph_t *glyph_cache_get(const uint8_t *font, char c, uint32_t scale);
+void glyph_cache_clear(void);
+void glyph_cache_get_stats(glyph_cache_stats_t *stats);
+
+#endif // GLYPH_CACHE_H
@@ -1,5 +1,16 @@
 #include "ssd1306.h"
 
+// Everything that touches the SPI, DMA or GPIOs sits in SSD1306_HOST guards;
+// host/ssd1306_emu.c provides those functions for the host build.
+#ifndef SSD1306_HOST
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+static int dma_chan = -1;
+static volatile bool dma_active;
+static ssd1306_dma_callback_t dma_callback;
+static void *dma_callback_ctx;
+
 inline void spi_cs_select(void) {
     asm volatile("nop \n nop \n nop");
     gpio_put(PIN_CS, 0); // Active low
@@ -11,6 +22,7 @@ inline void spi_cs_deselect(void) {
     gpio_put(PIN_CS, 1);
     asm volatile("nop \n nop \n nop");
 }
+#endif
 
 void ssd1306_set_display_start_line_address(uint8_t address) {
     // Make sure address is 6 bits
@@ -21,8 +33,9 @@ void ssd1306_set_display_start_line_address(uint8_t address) {
 void ssd1306_set_column_address(uint8_t address) {
     // Make sure the address is 7 bits
     address &= 0x7F;
-    ssd1306_write_command(SSD1306_CMD_COL_ADD_SET_MSB(address >> 4));
-    ssd1306_write_command(SSD1306_CMD_COL_ADD_SET_LSB(address & 0x0F));
+    const uint8_t cmds[] = { SSD1306_CMD_COL_ADD_SET_MSB(address >> 4),
+                             SSD1306_CMD_COL_ADD_SET_LSB(address & 0x0F) };
+    ssd1306_write_commands(cmds, sizeof(cmds));
 }
 
 void ssd1306_set_page_address(uint8_t address) {
@@ -40,8 +53,9 @@ void ssd1306_display_off(void) {
 }
 
 uint8_t ssd1306_set_contrast(uint8_t contrast) {
-    ssd1306_write_command(SSD1306_CMD_SET_CONTRAST_CONTROL_FOR_BANK0);
-    ssd1306_write_command(contrast);
+    const uint8_t cmds[] = { SSD1306_CMD_SET_CONTRAST_CONTROL_FOR_BANK0,
+                             contrast };
+    ssd1306_write_commands(cmds, sizeof(cmds));
     return contrast;
 }
 
@@ -55,13 +69,16 @@ void ssd1306_display_invert_disable(void) {
 
 void gfx_mono_ssd1306_put_byte(uint8_t page, uint8_t column, uint8_t data,
                                bool force) {
-
-    ssd1306_set_page_address(page);
-    ssd1306_set_column_address(column);
-
+    (void)force; // no local copy of the panel to compare against: always written
+    column &= 0x7F;
+    const uint8_t cmds[] = { SSD1306_CMD_SET_PAGE_START_ADDRESS(page & 0x0F),
+                             SSD1306_CMD_COL_ADD_SET_MSB(column >> 4),
+                             SSD1306_CMD_COL_ADD_SET_LSB(column & 0x0F) };
+    ssd1306_write_commands(cmds, sizeof(cmds));
     ssd1306_write_data(data);
 }
 
+#ifndef SSD1306_HOST
 void ssd1306_interface_init(void) {
     // active low
     gpio_init(SSD1306_RST_PIN);
@@ -92,82 +109,234 @@ void ssd1306_hard_reset(void) {
     busy_wait_us(SSD1306_LATENCY);
 }
 
-void ssd1306_write_command(uint8_t command) {
+static void ssd1306_dma_irq_handler(void) {
+    if (dma_chan < 0 || !dma_channel_get_irq0_status(dma_chan))
+        return;
+    dma_channel_acknowledge_irq0(dma_chan);
+    dma_active = false;
+
+    // The last bytes may still be in the SPI FIFO here; ssd1306_dma_wait()
+    // takes care of that before D/C changes again.
+    if (dma_callback)
+        dma_callback(dma_callback_ctx);
+}
+
+bool ssd1306_dma_init(void) {
+    if (dma_chan >= 0)
+        return true;
+
+    dma_chan = dma_claim_unused_channel(false);
+    if (dma_chan < 0)
+        return false;
+
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, spi_get_dreq(SPI_PORT, true));
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(dma_chan, &c, &spi_get_hw(SPI_PORT)->dr, NULL, 0,
+                          false);
+
+    dma_channel_set_irq0_enabled(dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_0, ssd1306_dma_irq_handler,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    return true;
+}
+
+bool ssd1306_dma_busy(void) {
+    return dma_active;
+}
+
+// Waits for the DMA transfer and for the SPI to shift out the last byte, so
+// D/C can be changed safely.
+void ssd1306_dma_wait(void) {
+    while (dma_active)
+        tight_loop_contents();
+
+    while (spi_is_busy(SPI_PORT))
+        tight_loop_contents();
+
+    // DMA only writes; drop whatever the SPI clocked in meanwhile
+    while (spi_is_readable(SPI_PORT))
+        (void)spi_get_hw(SPI_PORT)->dr;
+    spi_get_hw(SPI_PORT)->icr = SPI_SSPICR_RORIC_BITS;
+}
+
+// Streams len bytes of display data. Returns immediately; callback (if any)
+// runs in interrupt context once the DMA has consumed the buffer. Falls back
+// to a blocking write when no DMA channel is available.
+void ssd1306_write_data_dma(const uint8_t *data, size_t len,
+                            ssd1306_dma_callback_t callback, void *ctx) {
+    ssd1306_dma_wait();
+    gpio_put(SSD1306_DATA_CMD_SEL, 1);
+    spi_cs_select();
+
+    if (dma_chan < 0) {
+        spi_write_blocking(SPI_PORT, data, len);
+        if (callback)
+            callback(ctx);
+        return;
+    }
+
+    dma_callback = callback;
+    dma_callback_ctx = ctx;
+    dma_active = true;
+    dma_channel_transfer_from_buffer_now(dma_chan, data, len);
+}
+
+#endif
+
+// Sets the RAM window used by horizontal addressing mode; data written
+// afterwards fills it column by column, wrapping to the next page.
+void ssd1306_set_window(uint8_t col_start, uint8_t col_end, uint8_t page_start,
+                        uint8_t page_end) {
+    const uint8_t cmds[] = { SSD1306_CMD_SET_COLUMN_ADDRESS,
+                             col_start & 0x7F,
+                             col_end & 0x7F,
+                             SSD1306_CMD_SET_PAGE_ADDRESS,
+                             page_start & 0x07,
+                             page_end & 0x07 };
+    ssd1306_write_commands(cmds, sizeof(cmds));
+}
+
+// Continuous hardware scrolling. Each call is a single command burst; the
+// controller then moves the picture on its own with no further SPI traffic.
+// Scroll parameters may only change while scrolling is off, so the setup is
+// always preceded by a deactivate.
+//
+// Horizontal scrolling rotates the GDDRAM contents, so after
+// ssd1306_scroll_stop() the panel no longer matches the framebuffer: call
+// gfx_mark_dirty() and show again if the picture has to be restored.
+void ssd1306_scroll_horizontal(bool left, uint8_t page_start, uint8_t page_end,
+                               ssd1306_scroll_step_t step) {
+    const uint8_t cmds[] = { SSD1306_CMD_DEACTIVATE_SCROLL,
+                             left ? SSD1306_CMD_LEFT_HORIZONTAL_SCROLL
+                                  : SSD1306_CMD_RIGHT_HORIZONTAL_SCROLL,
+                             0x00,
+                             page_start & 0x07,
+                             step & 0x07,
+                             page_end & 0x07,
+                             0x00,
+                             0xFF,
+                             SSD1306_CMD_ACTIVATE_SCROLL };
+    ssd1306_write_commands(cmds, sizeof(cmds));
+}
+
+// Horizontal scroll of pages page_start..page_end combined with a vertical
+// scroll of rows_per_step rows per step. The vertical part only moves rows
+// fixed_rows..fixed_rows + scroll_rows - 1; rows above stay put (e.g. a
+// fixed title over a ticker). The controller has no purely vertical
+// continuous scroll; for vertical panning use the start line instead
+// (ssd1306_set_display_start_line_address).
+void ssd1306_scroll_diagonal(bool left, uint8_t page_start, uint8_t page_end,
+                             ssd1306_scroll_step_t step, uint8_t rows_per_step,
+                             uint8_t fixed_rows, uint8_t scroll_rows) {
+    const uint8_t cmds[] = { SSD1306_CMD_DEACTIVATE_SCROLL,
+                             SSD1306_CMD_SET_VERTICAL_SCROLL_AREA,
+                             fixed_rows & 0x3F,
+                             scroll_rows & 0x7F,
+                             left ? SSD1306_CMD_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL
+                                  : SSD1306_CMD_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL,
+                             0x00,
+                             page_start & 0x07,
+                             step & 0x07,
+                             page_end & 0x07,
+                             rows_per_step & 0x3F,
+                             SSD1306_CMD_ACTIVATE_SCROLL };
+    ssd1306_write_commands(cmds, sizeof(cmds));
+}
+
+void ssd1306_scroll_stop(void) {
+    ssd1306_write_command(SSD1306_CMD_DEACTIVATE_SCROLL);
+}
+
+#ifndef SSD1306_HOST
+// Sends a run of command bytes (and their arguments) in one SPI burst with
+// D/C low for all of them. spi_write_blocking returns only after the last
+// byte is shifted out, so no settle delay is needed before D/C changes.
+void ssd1306_write_commands(const uint8_t *commands, size_t len) {
+    ssd1306_dma_wait();
     gpio_put(SSD1306_DATA_CMD_SEL, 0);
     spi_cs_select();
-    spi_write_blocking(SPI_PORT, &command, 1);
+    spi_write_blocking(SPI_PORT, commands, len);
     // spi_cs_deselect();
-    busy_wait_us_32(4);
 }
 
 void ssd1306_write_data(uint8_t data) {
+    ssd1306_dma_wait();
     gpio_put(SSD1306_DATA_CMD_SEL, 1);
     spi_cs_select();
     spi_write_blocking(SPI_PORT, &data, 1);
     // spi_cs_deselect();
-    busy_wait_us_32(4);
+}
+#endif
+
+void ssd1306_write_command(uint8_t command) {
+    ssd1306_write_commands(&command, 1);
 }
 
 void ssd1306_put_page(uint8_t *data, uint8_t page, uint8_t column,
                       uint8_t width) {
-    ssd1306_set_page_address(page);
-    ssd1306_set_column_address(column);
-
-    do {
-        ssd1306_write_data(*data++);
-    } while (--width);
+    column &= 0x7F;
+    const uint8_t cmds[] = { SSD1306_CMD_SET_PAGE_START_ADDRESS(page & 0x0F),
+                             SSD1306_CMD_COL_ADD_SET_MSB(column >> 4),
+                             SSD1306_CMD_COL_ADD_SET_LSB(column & 0x0F) };
+    ssd1306_write_commands(cmds, sizeof(cmds));
+
+    ssd1306_write_data_dma(data, width, NULL, NULL);
+    ssd1306_dma_wait();
 }
 
-void ssd1306_init(void) {
-    ssd1306_interface_init();
-    ssd1306_hard_reset();
+static const uint8_t ssd1306_init_commands[] = {
     // 1/32 Duty (0x0F~0x3F)
-    ssd1306_write_command(SSD1306_CMD_SET_MULTIPLEX_RATIO);
-    ssd1306_write_command(0x1F);
+    SSD1306_CMD_SET_MULTIPLEX_RATIO, 0x1F,
 
     // Shift Mapping RAM Counter (0x00~0x3F)
-    ssd1306_write_command(SSD1306_CMD_SET_DISPLAY_OFFSET);
-    ssd1306_write_command(0x00);
+    SSD1306_CMD_SET_DISPLAY_OFFSET, 0x00,
 
     // Set Mapping RAM Display Start Line (0x00~0x3F)
-    ssd1306_write_command(SSD1306_CMD_SET_DISPLAY_START_LINE(0x40));
+    SSD1306_CMD_SET_DISPLAY_START_LINE(0x40),
 
-    // Set Mapping RAM Display Start Line (0x00~0x3F)
-    ssd1306_write_command(SSD1306_CMD_SET_MEMORY_ADDRESSING_MODE);
-    ssd1306_write_command(0);
+    // Horizontal addressing mode
+    SSD1306_CMD_SET_MEMORY_ADDRESSING_MODE, 0,
 
     // Set Column Address 0 Mapped to SEG0
-    ssd1306_write_command(SSD1306_CMD_SET_SEGMENT_RE_MAP_COL127_SEG0);
+    SSD1306_CMD_SET_SEGMENT_RE_MAP_COL127_SEG0,
 
     // Set COM/Row Scan Scan from COM63 to 0
-    ssd1306_write_command(0xC8);
+    SSD1306_CMD_SET_COM_OUTPUT_SCAN_DOWN,
 
     // Set COM Pins hardware configuration
-    ssd1306_write_command(SSD1306_CMD_SET_COM_PINS);
-    ssd1306_write_command(0x02);
+    SSD1306_CMD_SET_COM_PINS, 0x02,
 
-    ssd1306_set_contrast(0x8F);
+    SSD1306_CMD_SET_CONTRAST_CONTROL_FOR_BANK0, 0x8F,
 
     // Disable Entire display On
-    ssd1306_write_command(SSD1306_CMD_ENTIRE_DISPLAY_AND_GDDRAM_ON);
+    SSD1306_CMD_ENTIRE_DISPLAY_AND_GDDRAM_ON,
 
-    ssd1306_display_invert_disable();
+    SSD1306_CMD_SET_NORMAL_DISPLAY,
 
     // Set Display Clock Divide Ratio / Oscillator Frequency (Default => 0x80)
-    ssd1306_write_command(SSD1306_CMD_SET_DISPLAY_CLOCK_DIVIDE_RATIO);
-    ssd1306_write_command(0x80);
+    SSD1306_CMD_SET_DISPLAY_CLOCK_DIVIDE_RATIO, 0x80,
 
     // Enable charge pump regulator
-    ssd1306_write_command(SSD1306_CMD_SET_CHARGE_PUMP_SETTING);
-    ssd1306_write_command(0x14);
+    SSD1306_CMD_SET_CHARGE_PUMP_SETTING, 0x14,
 
     // Set VCOMH Deselect Level
-    ssd1306_write_command(SSD1306_CMD_SET_VCOMH_DESELECT_LEVEL);
-    ssd1306_write_command(0x40); // Default => 0x20 (0.77*VCC)
+    SSD1306_CMD_SET_VCOMH_DESELECT_LEVEL, 0x40, // Default => 0x20 (0.77*VCC)
 
     // Set Pre-Charge as 15 Clocks & Discharge as 1 Clock
-    ssd1306_write_command(SSD1306_CMD_SET_PRE_CHARGE_PERIOD);
-    ssd1306_write_command(0xF1);
+    SSD1306_CMD_SET_PRE_CHARGE_PERIOD, 0xF1,
+
+    SSD1306_CMD_SET_DISPLAY_ON,
+};
+
+void ssd1306_init(void) {
+    ssd1306_interface_init();
+    ssd1306_hard_reset();
+    ssd1306_write_commands(ssd1306_init_commands,
+                           sizeof(ssd1306_init_commands));
 
-    ssd1306_display_on();
+    ssd1306_dma_init();
 }
@@ -1,16 +1,43 @@
 #ifndef SSD1306_H
 #define SSD1306_H
 
+#ifdef SSD1306_HOST
+// Host build: the SPI/DMA transport is replaced by the emulator in host/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#else
 #include "hardware/gpio.h"
 #include "hardware/spi.h"
 #include "pico/stdlib.h"
+#endif
 #include <stdlib.h>
 
+typedef void (*ssd1306_dma_callback_t)(void *ctx);
+
+// Time between scroll steps, in frames (datasheet encoding)
+typedef enum {
+    SSD1306_SCROLL_5_FRAMES = 0,
+    SSD1306_SCROLL_64_FRAMES = 1,
+    SSD1306_SCROLL_128_FRAMES = 2,
+    SSD1306_SCROLL_256_FRAMES = 3,
+    SSD1306_SCROLL_3_FRAMES = 4,
+    SSD1306_SCROLL_4_FRAMES = 5,
+    SSD1306_SCROLL_25_FRAMES = 6,
+    SSD1306_SCROLL_2_FRAMES = 7,
+} ssd1306_scroll_step_t;
+
 #define SSD1306_CMD_COL_ADD_SET_LSB(column) (0x00 | (column))
 #define SSD1306_CMD_COL_ADD_SET_MSB(column) (0x10 | (column))
 #define SSD1306_CMD_SET_MEMORY_ADDRESSING_MODE 0x20
 #define SSD1306_CMD_SET_COLUMN_ADDRESS 0x21
 #define SSD1306_CMD_SET_PAGE_ADDRESS 0x22
+#define SSD1306_CMD_RIGHT_HORIZONTAL_SCROLL 0x26
+#define SSD1306_CMD_LEFT_HORIZONTAL_SCROLL 0x27
+#define SSD1306_CMD_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL 0x29
+#define SSD1306_CMD_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL 0x2A
+#define SSD1306_CMD_DEACTIVATE_SCROLL 0x2E
+#define SSD1306_CMD_ACTIVATE_SCROLL 0x2F
 #define SSD1306_CMD_SET_DISPLAY_START_LINE(line) (0x40 | (line))
 #define SSD1306_CMD_SET_CONTRAST_CONTROL_FOR_BANK0 0x81
 #define SSD1306_CMD_SET_CHARGE_PUMP_SETTING 0x8D
@@ -20,6 +47,7 @@
 #define SSD1306_CMD_ENTIRE_DISPLAY_ON 0xA5
 #define SSD1306_CMD_SET_NORMAL_DISPLAY 0xA6
 #define SSD1306_CMD_SET_INVERSE_DISPLAY 0xA7
+#define SSD1306_CMD_SET_VERTICAL_SCROLL_AREA 0xA3
 #define SSD1306_CMD_SET_MULTIPLEX_RATIO 0xA8
 #define SSD1306_CMD_SET_DISPLAY_ON 0xAF
 #define SSD1306_CMD_SET_DISPLAY_OFF 0xAE
@@ -42,32 +70,64 @@
 #define GFX_MONO_LCD_FRAMEBUFFER_SIZE \
     ((GFX_MONO_LCD_WIDTH * GFX_MONO_LCD_HEIGHT) / GFX_MONO_LCD_PIXELS_PER_BYTE)
 
+// Wiring; the defaults are the OLED1 Xplained Pro adapter on spi1. Boards
+// that wire the panel elsewhere set OLED1_SPI_PORT and OLED1_PIN_* in CMake.
+#ifndef SSD1306_RST_PIN
 #define SSD1306_RST_PIN 14
+#endif
+#ifndef SSD1306_DATA_CMD_SEL
 #define SSD1306_DATA_CMD_SEL 15
+#endif
 
+#ifndef PIN_SCK
 #define PIN_SCK 10
+#endif
+#ifndef PIN_TX
 #define PIN_TX 11
+#endif
+#ifndef PIN_CS
 #define PIN_CS 9
+#endif
+#ifndef SPI_PORT
 #define SPI_PORT spi1
+#endif
 #define SSD1306_LATENCY 10
 
-inline void spi_cs_select(void);
-inline void spi_cs_deselect(void);
-inline void ssd1306_set_display_start_line_address(uint8_t address);
-inline void ssd1306_set_column_address(uint8_t address);
-inline void ssd1306_set_page_address(uint8_t address);
-inline void ssd1306_display_on(void);
-inline void ssd1306_display_off(void);
-inline uint8_t ssd1306_set_contrast(uint8_t contrast);
-inline void ssd1306_display_invert_enable(void);
-inline void ssd1306_display_invert_disable(void);
+#ifndef SSD1306_HOST
+void spi_cs_select(void);
+void spi_cs_deselect(void);
+#endif
+void ssd1306_set_display_start_line_address(uint8_t address);
+void ssd1306_set_column_address(uint8_t address);
+void ssd1306_set_page_address(uint8_t address);
+void ssd1306_display_on(void);
+void ssd1306_display_off(void);
+uint8_t ssd1306_set_contrast(uint8_t contrast);
+void ssd1306_display_invert_enable(void);
+void ssd1306_display_invert_disable(void);
 
 void gfx_mono_ssd1306_put_byte(uint8_t page, uint8_t column, uint8_t data,
                                bool force);
 void ssd1306_interface_init(void);
 void ssd1306_hard_reset(void);
 void ssd1306_write_command(uint8_t command);
+void ssd1306_write_commands(const uint8_t *commands, size_t len);
 void ssd1306_write_data(uint8_t data);
 void ssd1306_init(void);
 
+void ssd1306_set_window(uint8_t col_start, uint8_t col_end, uint8_t page_start,
+                        uint8_t page_end);
+void ssd1306_scroll_horizontal(bool left, uint8_t page_start, uint8_t page_end,
+                               ssd1306_scroll_step_t step);
+void ssd1306_scroll_diagonal(bool left, uint8_t page_start, uint8_t page_end,
+                             ssd1306_scroll_step_t step, uint8_t rows_per_step,
+                             uint8_t fixed_rows, uint8_t scroll_rows);
+void ssd1306_scroll_stop(void);
+
+bool ssd1306_dma_init(void);
+void ssd1306_write_data_dma(const uint8_t *data, size_t len,
+                            ssd1306_dma_callback_t callback, void *ctx);
+bool ssd1306_dma_busy(void);
+void ssd1306_dma_wait(void);
+
 #endif // SSD1306_H
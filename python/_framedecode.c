@@ -0,0 +1,82 @@
+/*
+ * Implementação nativa opcional do laço de FrameDecoder.feed (protocol.py).
+ *
+ * scan(buf, resync) -> (events, consumed, errors, dropped, resync)
+ *
+ * Percorre buf exatamente como a versão em Python: um pacote é
+ * [button, lsb, msb, 0xFF]; fora de sincronia avança um byte por vez e
+ * conta um erro por sequência descartada.
+ *
+ * Compilar com: python setup.py build_ext --inplace
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#define FRAME_SIZE 4
+#define FRAME_END 0xFF
+
+static PyObject *scan(PyObject *self, PyObject *args) {
+    Py_buffer view;
+    int resync;
+
+    if (!PyArg_ParseTuple(args, "y*p", &view, &resync))
+        return NULL;
+
+    const unsigned char *buf = view.buf;
+    Py_ssize_t n = view.len;
+    Py_ssize_t i = 0;
+    long errors = 0, dropped = 0;
+
+    PyObject *events = PyList_New(0);
+    if (events == NULL) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    while (i + FRAME_SIZE <= n) {
+        if (buf[i + 3] == FRAME_END) {
+            int16_t value = (int16_t)(buf[i + 1] | (buf[i + 2] << 8));
+            PyObject *evt = PyTuple_New(2);
+            if (evt != NULL) {
+                PyTuple_SET_ITEM(evt, 0, PyLong_FromLong(buf[i]));
+                PyTuple_SET_ITEM(evt, 1, PyLong_FromLong(value));
+            }
+            if (evt == NULL || PyTuple_GET_ITEM(evt, 0) == NULL ||
+                PyTuple_GET_ITEM(evt, 1) == NULL ||
+                PyList_Append(events, evt) < 0) {
+                Py_XDECREF(evt);
+                Py_DECREF(events);
+                PyBuffer_Release(&view);
+                return NULL;
+            }
+            Py_DECREF(evt);
+            i += FRAME_SIZE;
+            resync = 0;
+        } else {
+            if (!resync) {
+                errors++;
+                resync = 1;
+            }
+            dropped++;
+            i++;
+        }
+    }
+
+    PyBuffer_Release(&view);
+    return Py_BuildValue("(NnllO)", events, i, errors, dropped,
+                         resync ? Py_True : Py_False);
+}
+
+static PyMethodDef framedecode_methods[] = {
+    {"scan", scan, METH_VARARGS, "Decodifica os pacotes completos de buf."},
+    {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef framedecode_module = {
+    PyModuleDef_HEAD_INIT, "_framedecode", NULL, -1, framedecode_methods,
+};
+
+PyMODINIT_FUNC PyInit__framedecode(void) {
+    return PyModule_Create(&framedecode_module);
+}
@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+"""Calibração inercial guiada do controle (acelerômetro e giroscópio).
+
+    python calibracao.py /dev/rfcomm0                   # roteiro completo e grava no controle
+    python calibracao.py /dev/rfcomm0 --salvar cap.json # guarda também as capturas
+    python calibracao.py --resolver cap.json [--porta /dev/rfcomm0]
+    python calibracao.py /dev/rfcomm0 --padrao          # volta à escala nominal
+
+Roteiro: o controle fica parado com cada uma das seis faces para cima e,
+entre uma posição e a seguinte, é girado 90°. As capturas paradas dão
+offset, sensibilidade e desalinhamento do acelerômetro (gravidade = 1 g na
+direção conhecida) e o offset do giroscópio; os giros, com o ângulo real
+medido pelo acelerômetro já calibrado antes e depois, dão sensibilidade e
+desalinhamento do giroscópio.
+
+Modelo igual ao FusionCalibrationInertial, com a medida em unidades
+nominais (contagens / contagens por unidade da faixa configurada no
+MPU-6050, que o controle informa em cada captura):
+
+    calibrado = M · ((bruto - offset) ∘ s)
+
+O firmware junta M, s e a escala numa só matriz (main/imu_cal.c) e guarda
+os coeficientes na flash.
+"""
+
+import argparse
+import json
+import math
+import queue
+import time
+
+from link import ConnectionManager
+from protocol import (CAL_ANGLE_SCALE, CAL_NAMES, CMD_CAL_CAPTURE, CMD_CAL_COMMIT, CMD_CAL_INDEX,
+                      CMD_CAL_VALUE, CODE_CAL_END, CODE_CAL_SAVED)
+
+IMU_SAMPLE_RATE = 100       # Hz, mpu6050_task
+
+# Formato dos parâmetros em main/imu_cal.h
+GAIN_ONE = 16384            # Q14: desalinhamento e sensibilidade
+OFFSET_ONE = 1024           # Q10: offset em °/s ou g
+UPLOAD_ATTEMPTS = 3         # envios quando o controle recusa ou não responde
+
+# Escalas das capturas gravadas antes de o controle informá-las (faixas de
+# fábrica do MPU-6050: ±250 °/s e ±2 g)
+LEGACY_GYRO_SCALE = 1310    # contagens por °/s * 10
+LEGACY_ACCEL_SCALE = 16384  # contagens por g
+
+STILL_SAMPLES = 200         # 2 s parado
+TURN_SAMPLES = 400          # 4 s para girar 90° e parar
+MAX_STILL_SPREAD = 600      # contagens; acima disso a posição é repetida
+
+# Faces para cima, em ordem tal que cada passo é um giro de 90°
+POSES = (
+    ('+Z (tela para cima)', (0.0, 0.0, 1.0)),
+    ('+X', (1.0, 0.0, 0.0)),
+    ('+Y', (0.0, 1.0, 0.0)),
+    ('-Z (tela para baixo)', (0.0, 0.0, -1.0)),
+    ('-X', (-1.0, 0.0, 0.0)),
+    ('-Y', (0.0, -1.0, 0.0)),
+)
+
+
+# ---------------------------------------------------------------------------
+# Álgebra linear mínima (listas de listas), para não depender do numpy
+
+def transpose(a):
+    return [list(row) for row in zip(*a)]
+
+
+def matmul(a, b):
+    bt = transpose(b)
+    return [[sum(x * y for x, y in zip(row, col)) for col in bt] for row in a]
+
+
+def inverse(a):
+    n = len(a)
+    m = [list(row) + [1.0 if i == j else 0.0 for j in range(n)] for i, row in enumerate(a)]
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(m[r][col]))
+        if abs(m[pivot][col]) < 1e-12:
+            raise ValueError("sistema singular: capturas insuficientes ou repetidas")
+        m[col], m[pivot] = m[pivot], m[col]
+        p = m[col][col]
+        m[col] = [x / p for x in m[col]]
+        for r in range(n):
+            if r != col and m[r][col]:
+                f = m[r][col]
+                m[r] = [x - f * y for x, y in zip(m[r], m[col])]
+    return [row[n:] for row in m]
+
+
+def least_squares(inputs, targets):
+    """P tal que targets ≈ P · inputs (colunas são as amostras)."""
+    return matmul(matmul(targets, transpose(inputs)), inverse(matmul(inputs, transpose(inputs))))
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def norm(v):
+    return math.sqrt(sum(x * x for x in v))
+
+
+def apply(matrix, vector):
+    return [sum(m * x for m, x in zip(row, vector)) for row in matrix]
+
+
+def split_gain(c):
+    """Decompõe C = M · diag(s), com s o módulo de cada coluna de C."""
+    s = [norm([c[r][j] for r in range(3)]) for j in range(3)]
+    m = [[c[r][j] / s[j] for j in range(3)] for r in range(3)]
+    return m, s
+
+
+# ---------------------------------------------------------------------------
+# Solução
+
+def solve(captures):
+    """Calcula os coeficientes a partir das capturas do roteiro.
+
+    captures = {'still': [captura por pose], 'turns': [captura por giro]},
+    cada captura com as chaves de CAL_NAMES e 'samples'. Capturas gravadas
+    antes de o controle informar 'gyro_scale'/'accel_scale' usam as escalas
+    de fábrica (LEGACY_*).
+    """
+    still, turns = captures['still'], captures['turns']
+    gyro_counts = still[0].get('gyro_scale', LEGACY_GYRO_SCALE) / 10.0
+    accel_counts = still[0].get('accel_scale', LEGACY_ACCEL_SCALE)
+
+    # Acelerômetro: gravidade conhecida em cada pose
+    inputs = transpose([[c[f'accel_{a}'] / accel_counts for a in 'xyz'] + [1.0] for c in still])
+    targets = transpose([list(up) for _, up in POSES[:len(still)]])
+    p = least_squares(inputs, targets)
+    c_accel = [row[:3] for row in p]
+    offset_accel = [-x for x in apply(inverse(c_accel), [row[3] for row in p])]
+
+    def accel_calibrated(c):
+        return apply(c_accel, [c[f'accel_{a}'] / accel_counts - o for a, o in zip('xyz', offset_accel)])
+
+    # Giroscópio: offset das poses paradas, ganho dos giros entre elas
+    offset_gyro = [sum(c[f'gyro_{a}'] for c in still) / len(still) / gyro_counts for a in 'xyz']
+    measured, actual = [], []
+    for i, c in enumerate(turns):
+        before = accel_calibrated(still[i])
+        after = accel_calibrated(still[i + 1])
+        before = [x / norm(before) for x in before]
+        after = [x / norm(after) for x in after]
+        axis = cross(before, after)
+        # A gravidade vista pelo sensor gira ao contrário do controle
+        angle = -math.degrees(math.atan2(norm(axis), sum(x * y for x, y in zip(before, after))))
+        actual.append([angle * x / norm(axis) for x in axis])
+        duration = c['samples'] / IMU_SAMPLE_RATE
+        measured.append([c[f'angle_{a}'] / CAL_ANGLE_SCALE - o * duration
+                         for a, o in zip('xyz', offset_gyro)])
+    # medido = A · real, e o calibrado é A⁻¹ · medido
+    a = least_squares(transpose(actual), transpose(measured))
+    c_gyro = inverse(a)
+
+    m_gyro, s_gyro = split_gain(c_gyro)
+    m_accel, s_accel = split_gain(c_accel)
+    result = {
+        'gyroscope': {'misalignment': m_gyro, 'sensitivity': s_gyro, 'offset': offset_gyro},
+        'accelerometer': {'misalignment': m_accel, 'sensitivity': s_accel, 'offset': offset_accel},
+    }
+
+    # Resíduos, para o usuário julgar a captura
+    accel_err = max(abs(norm(accel_calibrated(c)) - 1.0) for c in still)
+    gyro_err = max(norm([x - y for x, y in zip(apply(c_gyro, m), r)]) for m, r in zip(measured, actual))
+    return result, accel_err, gyro_err
+
+
+def encode(result):
+    """Coeficientes -> parâmetros int16, na ordem de imu_cal_set_param."""
+    values = []
+    for sensor in ('gyroscope', 'accelerometer'):
+        coef = result[sensor]
+        gains = [x for row in coef['misalignment'] for x in row] + list(coef['sensitivity'])
+        values += [round(x * GAIN_ONE) for x in gains]
+        values += [round(x * OFFSET_ONE) for x in coef['offset']]
+    for v in values:
+        if not -32768 <= v <= 32767:
+            raise ValueError(f"coeficiente fora da faixa do protocolo: {v}")
+    return values
+
+
+def params_check(values):
+    """Conferência enviada em CMD_CAL_COMMIT, igual a imu_cal_params_check."""
+    h = 0x811C9DC5
+    for v in values:
+        for byte in (v & 0xFFFF).to_bytes(2, 'little'):
+            h = ((h ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return h % 32767 + 1
+
+
+# ---------------------------------------------------------------------------
+# Comunicação
+
+class Sessao:
+    def __init__(self, port):
+        self._events = queue.Queue()
+        self.manager = ConnectionManager(port, lambda b, v: self._events.put((b, v)))
+        self.manager.start()
+        deadline = time.monotonic() + 10
+        while not self.manager.connected:
+            if time.monotonic() > deadline:
+                raise SystemExit(f"não foi possível conectar em {port}")
+            time.sleep(0.1)
+
+    def close(self):
+        self.manager.stop()
+
+    def _poll(self, code, timeout):
+        """Como _wait, mas devolve None se a resposta não chega."""
+        deadline = time.monotonic() + timeout
+        values = {}
+        while True:
+            try:
+                button, value = self._events.get(timeout=max(0.0, deadline - time.monotonic()))
+            except queue.Empty:
+                return None
+            if button in CAL_NAMES:
+                values[CAL_NAMES[button]] = value
+            elif button == code:
+                return values, value
+
+    def _wait(self, code, timeout):
+        reply = self._poll(code, timeout)
+        if reply is None:
+            raise SystemExit("o controle não respondeu")
+        return reply
+
+    def capture(self, samples):
+        self.manager.send_command(CMD_CAL_CAPTURE, samples)
+        values, count = self._wait(CODE_CAL_END, samples / IMU_SAMPLE_RATE + 5)
+        values['samples'] = count
+        return values
+
+    def upload(self, values):
+        """Envia os parâmetros; o controle só grava se a conferência bate
+        (resposta 1). Resposta -1 é um pacote perdido ou repetido no
+        caminho, e sem resposta o commit se perdeu (o controle descarta o
+        que chega enquanto apaga a flash, ver main/flash_store.h): envia
+        de novo."""
+        check = params_check(values)
+        for tentativa in range(UPLOAD_ATTEMPTS):
+            self.manager.send_command(CMD_CAL_INDEX, 0)
+            for v in values:
+                self.manager.send_command(CMD_CAL_VALUE, v)
+            self.manager.send_command(CMD_CAL_COMMIT, check)
+            reply = self._poll(CODE_CAL_SAVED, 5)
+            if reply is None:
+                print(f"o controle não respondeu (tentativa {tentativa + 1}), enviando de novo")
+                continue
+            if reply[1] != -1:
+                return reply[1] == 1
+            print(f"o controle recusou os parâmetros (tentativa {tentativa + 1}), enviando de novo")
+        return False
+
+    def reset(self):
+        for _ in range(UPLOAD_ATTEMPTS):
+            self.manager.send_command(CMD_CAL_COMMIT, 0)
+            reply = self._poll(CODE_CAL_SAVED, 5)
+            if reply is not None:
+                return reply[1] == 1
+        raise SystemExit("o controle não respondeu")
+
+
+def roteiro(sessao):
+    still, turns = [], []
+    for i, (nome, _) in enumerate(POSES):
+        if i:
+            input(f"Enter e, em seguida, gire 90° até a face {nome} ficar para cima e segure...")
+            turns.append(sessao.capture(TURN_SAMPLES))
+        else:
+            input(f"Apoie o controle parado com a face {nome} para cima e pressione Enter...")
+        while True:
+            c = sessao.capture(STILL_SAMPLES)
+            if c['spread'] <= MAX_STILL_SPREAD:
+                break
+            input(f"O controle se mexeu (variação {c['spread']}); segure a face {nome} parada e Enter...")
+        still.append(c)
+        print(f"  {nome}: acel {[c[f'accel_{a}'] for a in 'xyz']}  giro {[c[f'gyro_{a}'] for a in 'xyz']}")
+    return {'still': still, 'turns': turns}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Calibração inercial guiada do controle")
+    parser.add_argument("porta", nargs="?")
+    parser.add_argument("--porta", dest="porta_envio", help="com --resolver: envia o resultado para esta porta")
+    parser.add_argument("--salvar", help="grava as capturas em JSON")
+    parser.add_argument("--resolver", help="resolve capturas gravadas com --salvar, sem roteiro")
+    parser.add_argument("--padrao", action="store_true", help="volta o controle à escala nominal")
+    args = parser.parse_args()
+
+    port = args.porta or args.porta_envio
+    if args.resolver:
+        with open(args.resolver) as f:
+            captures = json.load(f)
+    elif not port:
+        parser.error("informe a porta ou --resolver")
+
+    sessao = Sessao(port) if port else None
+    try:
+        if args.padrao:
+            print("restaurado" if sessao.reset() else "falha ao gravar na flash")
+            return
+        if not args.resolver:
+            captures = roteiro(sessao)
+            if args.salvar:
+                with open(args.salvar, 'w') as f:
+                    json.dump(captures, f, indent=1)
+
+        result, accel_err, gyro_err = solve(captures)
+        for sensor, coef in result.items():
+            print(f"{sensor}:")
+            for row in coef['misalignment']:
+                print("   " + "  ".join(f"{x:9.5f}" for x in row))
+            print("   sensibilidade " + "  ".join(f"{x:.5f}" for x in coef['sensitivity']))
+            print("   offset " + "  ".join(f"{x:.4f}" for x in coef['offset']))
+        print(f"erro residual: acelerômetro {accel_err * 1000:.1f} mg, giroscópio {gyro_err:.2f}°")
+
+        if sessao:
+            print("gravado no controle" if sessao.upload(encode(result)) else "falha ao gravar no controle")
+    finally:
+        if sessao:
+            sessao.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,193 @@
+"""Gravação e reprodução de sessões do controle.
+
+Formato do arquivo (little-endian):
+
+    cabeçalho (32 bytes)
+        magic       8s   b'LBCAP\\x00\\x00\\x00'
+        version     H    CAPTURE_VERSION
+        flags       H    reservado (0)
+        baud        I    baud rate da porta gravada
+        start_ns    Q    time.time_ns() no início da gravação
+        reserved    8s
+
+    registros, um após o outro
+        delta_us    I    microssegundos desde o registro anterior
+        kind        B    KIND_RAW, KIND_EVENT ou KIND_MARK
+        reserved    B
+        length      H    tamanho do payload
+        payload     length bytes
+
+KIND_RAW guarda os bytes exatamente como vieram de ser.read(), KIND_EVENT
+guarda o evento decodificado (button u8, value i16) e KIND_MARK um texto
+livre. Como os registros são autocontidos e sequenciais, o arquivo pode ser
+escrito em streaming e lido via mmap sem carregar a sessão inteira na RAM.
+"""
+
+import mmap
+import struct
+import time
+
+CAPTURE_MAGIC = b'LBCAP\x00\x00\x00'
+CAPTURE_VERSION = 1
+
+KIND_RAW = 1
+KIND_EVENT = 2
+KIND_MARK = 3
+
+_HEADER = struct.Struct('<8sHHIQ8s')
+_RECORD = struct.Struct('<IBBH')
+_EVENT = struct.Struct('<Bh')
+
+_MAX_DELTA_US = 0xFFFFFFFF
+_MAX_PAYLOAD = 0xFFFF
+
+
+class CaptureWriter:
+    def __init__(self, path, baud=9600):
+        self._file = open(path, 'wb')
+        self._file.write(_HEADER.pack(CAPTURE_MAGIC, CAPTURE_VERSION, 0, baud,
+                                      time.time_ns(), b''))
+        self._last_ns = time.monotonic_ns()
+
+    def _write(self, kind, payload):
+        now = time.monotonic_ns()
+        delta_us = (now - self._last_ns) // 1000
+        # Um intervalo maior que ~71 min vira registros vazios de preenchimento
+        while delta_us > _MAX_DELTA_US:
+            self._file.write(_RECORD.pack(_MAX_DELTA_US, KIND_MARK, 0, 0))
+            delta_us -= _MAX_DELTA_US
+        self._last_ns = now
+        for start in range(0, max(len(payload), 1), _MAX_PAYLOAD):
+            chunk = payload[start:start + _MAX_PAYLOAD]
+            self._file.write(_RECORD.pack(delta_us, kind, 0, len(chunk)))
+            self._file.write(chunk)
+            delta_us = 0
+
+    def write_raw(self, data):
+        if data:
+            self._write(KIND_RAW, bytes(data))
+
+    def write_event(self, button, value):
+        self._write(KIND_EVENT, _EVENT.pack(button & 0xFF, value))
+
+    def write_mark(self, text):
+        self._write(KIND_MARK, text.encode('utf-8'))
+
+    def close(self):
+        if not self._file.closed:
+            self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class CaptureReader:
+    """Itera sobre os registros de uma captura via mmap.
+
+    Cada registro é devolvido como (t_us, kind, payload), onde t_us é o tempo
+    desde o início da gravação. Só o registro atual é copiado do mmap.
+    """
+
+    def __init__(self, path):
+        self._file = open(path, 'rb')
+        self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        if len(self._map) < _HEADER.size:
+            self.close()
+            raise ValueError(f'{path}: arquivo de captura truncado')
+        magic, version, _, baud, start_ns, _ = _HEADER.unpack_from(self._map, 0)
+        if magic != CAPTURE_MAGIC or version != CAPTURE_VERSION:
+            self.close()
+            raise ValueError(f'{path}: não é uma captura LBCAP v{CAPTURE_VERSION}')
+        self.baud = baud
+        self.start_ns = start_ns
+
+    def __iter__(self):
+        offset = _HEADER.size
+        end = len(self._map)
+        t_us = 0
+        while offset + _RECORD.size <= end:
+            delta_us, kind, _, length = _RECORD.unpack_from(self._map, offset)
+            offset += _RECORD.size
+            if offset + length > end:
+                break  # último registro truncado (gravação interrompida)
+            t_us += delta_us
+            yield t_us, kind, self._map[offset:offset + length]
+            offset += length
+
+    def events(self):
+        for t_us, kind, payload in self:
+            if kind == KIND_EVENT:
+                button, value = _EVENT.unpack(payload)
+                yield t_us, button, value
+
+    def close(self):
+        self._map.close()
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class RecordingSerial:
+    """Envolve um serial.Serial e grava tudo o que é lido."""
+
+    def __init__(self, ser, writer):
+        self._ser = ser
+        self._writer = writer
+
+    def read(self, size=1):
+        data = self._ser.read(size)
+        self._writer.write_raw(data)
+        return data
+
+    def __getattr__(self, name):
+        return getattr(self._ser, name)
+
+
+class ReplaySerial:
+    """Imita serial.Serial.read() a partir dos bytes crus de uma captura.
+
+    speed=1.0 reproduz em tempo real, speed=0 reproduz o mais rápido possível.
+    Quando a captura acaba, read() levanta EOFError.
+    """
+
+    def __init__(self, reader, speed=1.0):
+        self._records = (r for r in reader if r[1] == KIND_RAW)
+        self._speed = speed
+        self._pending = b''
+        self._t0 = None
+        self.is_open = True
+
+    def _next_chunk(self):
+        t_us, _, payload = next(self._records)
+        if self._speed > 0:
+            if self._t0 is None:
+                self._t0 = time.monotonic() - t_us / 1e6 / self._speed
+            wait = self._t0 + t_us / 1e6 / self._speed - time.monotonic()
+            if wait > 0:
+                time.sleep(wait)
+        return payload
+
+    def read(self, size=1):
+        while len(self._pending) < size:
+            try:
+                self._pending += self._next_chunk()
+            except StopIteration:
+                if not self._pending:
+                    raise EOFError('fim da captura')
+                break
+        data, self._pending = self._pending[:size], self._pending[size:]
+        return data
+
+    @property
+    def in_waiting(self):
+        return len(self._pending)
+
+    def close(self):
+        self.is_open = False
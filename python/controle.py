@@ -0,0 +1,131 @@
+"""Tradução dos eventos do controle em teclado/mouse.
+
+Controle guarda o estado de um controle (tilts pressionados) e manda as
+ações para um "dispositivo" de saída:
+
+- PyAutoGuiDevice: teclado e mouse do sistema (compartilhado);
+- UInputDevice: um dispositivo virtual próprio no Linux (python-evdev), para
+  que vários controles apareçam separados para o jogo.
+"""
+
+from protocol import is_ahrs, is_cal, is_imu, is_stat
+
+BUTTON_KEYS = {3: 'A', 4: 'B', 5: 'Z', 6: 'X'}
+# Gestos (main/gesture.h): chegam só quando reconhecidos e viram um toque
+GESTURE_KEYS = {10: 'space', 11: 'C', 12: 'V'}  # chacoalhar (item), soco, flick
+
+
+class PyAutoGuiDevice:
+    def __init__(self):
+        import pyautogui
+        pyautogui.PAUSE = 0
+        self._gui = pyautogui
+
+    def key_down(self, key):
+        self._gui.keyDown(key)
+
+    def key_up(self, key):
+        self._gui.keyUp(key)
+
+    def move_rel(self, dx, dy):
+        self._gui.moveRel(dx, dy)
+
+    def close(self):
+        pass
+
+
+class UInputDevice:
+    _KEYS = ('A', 'B', 'Z', 'X', 'C', 'V', 'space', 'up', 'down')
+
+    def __init__(self, name):
+        from evdev import UInput, ecodes
+        self._ecodes = ecodes
+        self._codes = {k: getattr(ecodes, 'KEY_' + k.upper()) for k in self._KEYS}
+        caps = {
+            ecodes.EV_KEY: list(self._codes.values()) + [ecodes.BTN_LEFT],
+            ecodes.EV_REL: [ecodes.REL_X, ecodes.REL_Y],
+        }
+        self._ui = UInput(caps, name=name)
+
+    def _key(self, key, state):
+        self._ui.write(self._ecodes.EV_KEY, self._codes[key], state)
+        self._ui.syn()
+
+    def key_down(self, key):
+        self._key(key, 1)
+
+    def key_up(self, key):
+        self._key(key, 0)
+
+    def move_rel(self, dx, dy):
+        if dx:
+            self._ui.write(self._ecodes.EV_REL, self._ecodes.REL_X, dx)
+        if dy:
+            self._ui.write(self._ecodes.EV_REL, self._ecodes.REL_Y, dy)
+        self._ui.syn()
+
+    def close(self):
+        self._ui.close()
+
+
+class Controle:
+    """Traduz eventos do controle em teclas e movimentos de mouse."""
+
+    def __init__(self, device=None):
+        self.device = device or PyAutoGuiDevice()
+        self.left_pressed = False
+        self.right_pressed = False
+
+    def move_mouse(self, button, value):
+        if button == 0:
+            self.device.move_rel(-value, 0)
+        elif button == 1:
+            self.device.move_rel(0, value)
+
+    def handle_button(self, button, value):
+        key = BUTTON_KEYS.get(button)
+        if key is None:
+            return
+        if value == 1:
+            self.device.key_down(key)
+        elif value == 0:
+            self.device.key_up(key)
+
+    def handle_gesture(self, button, value):
+        if value == 1:
+            key = GESTURE_KEYS[button]
+            self.device.key_down(key)
+            self.device.key_up(key)
+
+    def handle_event(self, button, value):
+        if is_stat(button) or is_cal(button) or is_ahrs(button) or is_imu(button):
+            return
+
+        if button in (0, 1):
+            self.move_mouse(button, value)
+
+        elif button == 8:  # Tilt esquerda
+            if value == 1 and not self.left_pressed:
+                self.device.key_down('down')
+                self.device.key_up('up')
+                self.left_pressed = True
+                self.right_pressed = False
+            elif value == 0 and self.left_pressed:
+                self.device.key_up('down')
+                self.left_pressed = False
+
+        elif button == 9:  # Tilt direita
+            if value == 1 and not self.right_pressed:
+                self.device.key_down('up')
+                self.device.key_up('down')
+                self.right_pressed = True
+                self.left_pressed = False
+            elif value == 0 and self.right_pressed:
+                self.device.key_up('up')
+                self.right_pressed = False
+
+        elif button in GESTURE_KEYS:
+            self.handle_gesture(button, value)
+
+        else:
+            self.handle_button(button, value)
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Confere o decodificador nativo (_framedecode.c) contra o de Python.
+
+    python framedecode_check.py                    # vetores + comparação aleatória + benchmark
+    python framedecode_check.py -n 200000          # pacotes no benchmark
+    python framedecode_check.py --capture s.lbcap  # e uma sessão gravada
+
+Os dois passam pelos mesmos vetores, com o resultado esperado escrito à
+mão em framedecode_vectors.json (o mesmo arquivo que o setup.py confere
+depois de compilar o módulo), e por fluxos aleatórios (pacotes válidos
+misturados com lixo, cortados em blocos de tamanho qualquer), em que as
+saídas têm que ser idênticas. Com --capture os bytes crus de uma captura
+(capture.py) passam pelos dois, nos blocos em que foram lidos da porta:
+eventos, contadores de erro e bytes que sobraram têm que bater, e o tempo
+por pacote de cada um é mostrado. Sai com código 1 se algo diverge ou se o
+módulo nativo não foi compilado (python setup.py build_ext --inplace).
+"""
+
+import argparse
+import json
+import os
+import random
+import struct
+import sys
+import time
+
+from capture import KIND_RAW, CaptureReader
+from protocol import FRAME_END, FrameDecoder, NATIVE_DECODER, _scan_py
+
+if NATIVE_DECODER:
+    from _framedecode import scan as _scan_native
+
+
+def frame(button, value):
+    return struct.pack('<BhB', button, value, FRAME_END)
+
+
+VECTORS_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'framedecode_vectors.json')
+
+
+def load_vectors(path=VECTORS_PATH):
+    """Devolve [(nome, buf, resync de entrada, (events, consumed, errors, dropped, resync))]."""
+    with open(path, encoding='utf-8') as f:
+        return [(v['nome'], bytes.fromhex(v['bytes']), v['resync'],
+                 ([tuple(e) for e in v['eventos']], v['consumidos'], v['erros'],
+                  v['descartados'], v['resync_final']))
+                for v in json.load(f)]
+
+
+def check_vectors(scan, vectors):
+    """Devolve as mensagens de erro de scan nos vetores."""
+    failures = []
+    for name, buf, resync, expected in vectors:
+        got = scan(buf, resync)
+        if tuple(got) != expected:
+            failures.append(f"{name}: {got} != {expected}")
+    return failures
+
+
+def random_stream(rng, frames):
+    out = bytearray()
+    for _ in range(frames):
+        if rng.random() < 0.05:
+            out += bytes(rng.randrange(255) for _ in range(rng.randint(1, 6)))
+        out += frame(rng.randrange(256), rng.randint(-32768, 32767))
+    return bytes(out)
+
+
+def feed_chunks(decoder, data, rng):
+    events = []
+    i = 0
+    while i < len(data):
+        n = rng.randint(1, 64)
+        events += decoder.feed(data[i:i + n])
+        i += n
+    return events, decoder.errors, decoder.dropped_bytes
+
+
+def capture_chunks(path):
+    with CaptureReader(path) as reader:
+        return [bytes(payload) for _, kind, payload in reader if kind == KIND_RAW]
+
+
+def feed_capture(native, chunks):
+    decoder = FrameDecoder(native=native)
+    start = time.perf_counter()
+    events = [e for chunk in chunks for e in decoder.feed(chunk)]
+    elapsed = time.perf_counter() - start
+    return (events, decoder.errors, decoder.dropped_bytes, decoder.pending), elapsed
+
+
+def check_capture(path, repeats=5):
+    """Confere os dois decodificadores numa captura; devolve 0 ou 1 falha."""
+    chunks = capture_chunks(path)
+    size = sum(len(c) for c in chunks)
+    results = {}
+    for impl, native in (('python', False), ('nativo', True)):
+        if native and not NATIVE_DECODER:
+            continue
+        best = float('inf')
+        for _ in range(repeats):
+            result, elapsed = feed_capture(native, chunks)
+            best = min(best, elapsed)
+        results[impl] = result
+        events, errors, dropped, pending = result
+        print(f"{impl:7s} {path}: {len(events)} pacotes, {errors} erros, {dropped} bytes descartados, "
+              f"{len(pending)} sobrando; {best * 1e9 / max(len(events), 1):.0f} ns/pacote")
+    print(f"captura: {len(chunks)} leituras, {size} bytes")
+    if len(results) == 2 and results['python'] != results['nativo']:
+        print(f"{path}: python e nativo divergem")
+        return 1
+    return 0
+
+
+def bench(scan, data, repeats=5):
+    best = float('inf')
+    for _ in range(repeats):
+        start = time.perf_counter()
+        scan(data, False)
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Confere _framedecode contra protocol._scan_py")
+    parser.add_argument('-n', type=int, default=100000, help="pacotes no benchmark")
+    parser.add_argument('-s', type=int, default=20, help="fluxos aleatórios")
+    parser.add_argument('--capture', metavar='arquivo.lbcap', action='append', default=[],
+                        help="captura de capture.py para conferir e medir (pode repetir)")
+    args = parser.parse_args()
+
+    scanners = [('python', _scan_py)]
+    if NATIVE_DECODER:
+        scanners.append(('nativo', _scan_native))
+
+    vectors = load_vectors()
+    failures = 0
+    for impl, scan in scanners:
+        for message in check_vectors(scan, vectors):
+            print(f"{impl}: {message}")
+            failures += 1
+    print(f"{len(vectors)} vetores: {'ok' if not failures else 'FALHA'}")
+
+    if NATIVE_DECODER:
+        rng = random.Random(1)
+        bad = 0
+        for seed in range(args.s):
+            data = random_stream(random.Random(seed), 2000)
+            chunk_seed = rng.randrange(1 << 30)
+            a = feed_chunks(FrameDecoder(native=False), data, random.Random(chunk_seed))
+            b = feed_chunks(FrameDecoder(native=True), data, random.Random(chunk_seed))
+            if a != b or _scan_py(data, False) != _scan_native(data, False):
+                print(f"fluxo {seed}: python e nativo divergem")
+                bad += 1
+        print(f"{args.s} fluxos aleatórios: {'ok' if not bad else 'FALHA'}")
+        failures += bad
+
+    data = random_stream(random.Random(99), args.n)
+    for impl, scan in scanners:
+        t = bench(scan, data)
+        print(f"{impl:7s} {args.n / t / 1e6:6.2f} M pacotes/s  ({t * 1e9 / args.n:.0f} ns/pacote)")
+
+    for path in args.capture:
+        failures += check_capture(path)
+
+    if not NATIVE_DECODER:
+        print("módulo nativo não compilado: python setup.py build_ext --inplace")
+        return 1
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
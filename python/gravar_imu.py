@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Grava uma sessão da IMU do controle em CSV, para as ferramentas do host.
+
+    python gravar_imu.py /dev/rfcomm0 soco.csv            # 5 s
+    python gravar_imu.py /dev/rfcomm0 chacoalhar.csv -s 3
+
+O controle guarda as amostras que o AHRS recebe (giroscópio já sem offset,
+em °/s, e acelerômetro calibrado, em g) e depois as manda pelo link, o que
+leva uns 2,5 s por segundo gravado a 9600 baud. O arquivo sai no formato
+de host/imu_log.h (t_s,gx,gy,gz,ax,ay,az) e pode ser passado para
+gesture_check (com -e para conferir os gestos feitos), ahrs_sweep e
+ahrs_soa_check.
+"""
+
+import argparse
+import queue
+import time
+
+from link import ConnectionManager
+from protocol import (CMD_IMU_RECORD, CODE_IMU_END, IMU_CODES, IMU_RECORD_ACCEL_ONE,
+                      IMU_RECORD_GYRO_ONE)
+
+IMU_SAMPLE_RATE = 100       # Hz, mpu6050_task
+MAX_SECONDS = 6.0           # IMU_RECORD_MAX_SAMPLES
+SECONDS_TO_SEND = 2.5       # por segundo gravado, a 9600 baud
+
+
+def gravar(port, seconds):
+    events = queue.Queue()
+    manager = ConnectionManager(port, lambda b, v: events.put((b, v)))
+    manager.start()
+    try:
+        deadline = time.monotonic() + 10
+        while not manager.connected:
+            if time.monotonic() > deadline:
+                raise SystemExit(f"não foi possível conectar em {port}")
+            time.sleep(0.1)
+
+        samples = round(seconds * IMU_SAMPLE_RATE)
+        input(f"Enter e faça o movimento ({seconds:g} s)...")
+        manager.send_command(CMD_IMU_RECORD, samples)
+        print("gravando...")
+
+        values = []
+        deadline = time.monotonic() + seconds * (1 + SECONDS_TO_SEND) + 5
+        while True:
+            try:
+                button, value = events.get(timeout=max(0.0, deadline - time.monotonic()))
+            except queue.Empty:
+                raise SystemExit(f"o controle parou de mandar ({len(values) // 6} amostras)") from None
+            if button in IMU_CODES:
+                if IMU_CODES.index(button) != len(values) % 6:
+                    raise SystemExit("pacote perdido na gravação; grave de novo")
+                values.append(value)
+            elif button == CODE_IMU_END:
+                if value != samples or len(values) != 6 * samples:
+                    raise SystemExit("pacote perdido na gravação; grave de novo")
+                return [values[i:i + 6] for i in range(0, len(values), 6)]
+    finally:
+        manager.stop()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Grava a IMU do controle em CSV")
+    parser.add_argument("porta")
+    parser.add_argument("saida", help="arquivo CSV")
+    parser.add_argument("-s", type=float, default=5.0, help=f"segundos (até {MAX_SECONDS:g})")
+    args = parser.parse_args()
+    if not 0 < args.s <= MAX_SECONDS:
+        parser.error(f"-s entre 0 e {MAX_SECONDS:g}")
+
+    amostras = gravar(args.porta, args.s)
+    with open(args.saida, 'w') as f:
+        f.write("t_s,gx,gy,gz,ax,ay,az\n")
+        for i, a in enumerate(amostras):
+            gyro = [x / IMU_RECORD_GYRO_ONE for x in a[:3]]
+            accel = [x / IMU_RECORD_ACCEL_ONE for x in a[3:]]
+            f.write(f"{(i + 1) / IMU_SAMPLE_RATE:.2f}," + ",".join(f"{x:.4f}" for x in gyro + accel) + "\n")
+    print(f"{len(amostras)} amostras em {args.saida}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Modo hub: vários controles num único processo.
+
+    python hub.py /dev/rfcomm0 /dev/rfcomm1 [...] [--uinput]
+
+Todas as portas são lidas por um único laço com selectors (epoll no Linux),
+sem uma thread por porta. Cada porta recebe um ID de controle na ordem da
+linha de comando; com --uinput cada controle vira um dispositivo virtual
+separado (python-evdev), senão todos usam o teclado/mouse do sistema.
+Portas que caem são reabertas com backoff pelo próprio laço. Só funciona
+em sistemas POSIX, onde a porta serial tem um file descriptor.
+"""
+
+import argparse
+import selectors
+import time
+import traceback
+
+import serial
+
+from controle import Controle, PyAutoGuiDevice, UInputDevice
+from link import BAUD_RATE, RECONNECT_MAX_S, RECONNECT_MIN_S, LinkHealth
+from protocol import FrameDecoder
+
+STATUS_PERIOD_S = 5.0
+
+
+class Link:
+    def __init__(self, controller_id, port, device):
+        self.controller_id = controller_id
+        self.port = port
+        self.controle = Controle(device)
+        self.decoder = FrameDecoder()
+        self.health = LinkHealth()
+        self.ser = None
+        self.backoff = RECONNECT_MIN_S
+        self.retry_at = 0.0
+
+
+class Hub:
+    def __init__(self, ports, uinput=False, on_event=None):
+        self._selector = selectors.DefaultSelector()
+        shared = None if uinput else PyAutoGuiDevice()
+        self.links = []
+        for controller_id, port in enumerate(ports):
+            device = UInputDevice(f"la-borratxeria-{controller_id}") if uinput else shared
+            self.links.append(Link(controller_id, port, device))
+        self._on_event = on_event
+
+    def _open(self, link, now):
+        try:
+            link.ser = serial.Serial(link.port, BAUD_RATE, timeout=0)
+        except (OSError, serial.SerialException):
+            link.retry_at = now + link.backoff
+            link.backoff = min(link.backoff * 2, RECONNECT_MAX_S)
+            return
+        link.backoff = RECONNECT_MIN_S
+        link.decoder.reset()
+        self._selector.register(link.ser, selectors.EVENT_READ, link)
+        print(f"[{link.controller_id}] conectado em {link.port}")
+
+    def _close(self, link, now):
+        self._selector.unregister(link.ser)
+        link.ser.close()
+        link.ser = None
+        link.retry_at = now + link.backoff
+        print(f"[{link.controller_id}] conexão perdida em {link.port}")
+
+    def _read(self, link, now):
+        try:
+            data = link.ser.read(link.ser.in_waiting or 1)
+        except (OSError, serial.SerialException):
+            self._close(link, now)
+            return
+        if not data:
+            return
+        errors = link.decoder.errors
+        events = link.decoder.feed(data)
+        link.health.on_data(len(data), len(events), link.decoder.errors - errors, now)
+        for button, value in events:
+            try:
+                if self._on_event:
+                    self._on_event(link.controller_id, button, value)
+                link.controle.handle_event(button, value)
+            except Exception:
+                # Um erro no mapeamento de um controle não derruba os outros
+                link.health.on_handler_error()
+                print(f"[{link.controller_id}] erro tratando button={button} value={value}")
+                traceback.print_exc()
+
+    def run(self):
+        next_status = time.monotonic() + STATUS_PERIOD_S
+        while True:
+            now = time.monotonic()
+            for link in self.links:
+                if link.ser is None and now >= link.retry_at:
+                    self._open(link, now)
+
+            if now >= next_status:
+                for link in self.links:
+                    state = link.health.summary() if link.ser else "desconectado"
+                    print(f"[{link.controller_id}] {link.port}: {state}")
+                next_status = now + STATUS_PERIOD_S
+
+            pending = [l.retry_at for l in self.links if l.ser is None]
+            timeout = max(0.0, min(pending + [next_status]) - now)
+            if not self._selector.get_map():
+                time.sleep(timeout)
+                continue
+
+            for key, _ in self._selector.select(timeout):
+                self._read(key.data, time.monotonic())
+
+    def close(self):
+        for link in self.links:
+            if link.ser:
+                link.ser.close()
+            link.controle.device.close()
+        self._selector.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Vários controles num único processo")
+    parser.add_argument("portas", nargs="+")
+    parser.add_argument("--uinput", action="store_true", help="um dispositivo virtual (evdev) por controle")
+    parser.add_argument("--verbose", action="store_true", help="imprime cada evento com o ID do controle")
+    args = parser.parse_args()
+
+    def log_event(controller_id, button, value):
+        print(f"[{controller_id}] button={button} value={value}")
+
+    hub = Hub(args.portas, uinput=args.uinput, on_event=log_event if args.verbose else None)
+    try:
+        hub.run()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        hub.close()
+
+
+if __name__ == "__main__":
+    main()
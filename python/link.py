@@ -0,0 +1,220 @@
+"""Gerência da conexão serial com o controle.
+
+- serial_ports(): descoberta de portas, com sondagem paralela no Windows;
+- LinkHealth: bytes/s, taxa de erro de framing e histograma de intervalos;
+- ConnectionManager: thread de leitura que reconecta sozinha com backoff.
+"""
+
+import glob
+import sys
+import threading
+import time
+import traceback
+from concurrent.futures import ThreadPoolExecutor
+
+import serial
+
+from protocol import FrameDecoder, encode_command
+
+BAUD_RATE = 9600
+
+RECONNECT_MIN_S = 0.05
+RECONNECT_MAX_S = 2.0
+
+# Limites superiores (ms) das faixas do histograma de intervalos entre pacotes
+GAP_BINS_MS = (10, 20, 50, 100, 250, 1000)
+
+
+def _probe(port):
+    try:
+        s = serial.Serial(port)
+        s.close()
+        return port
+    except (OSError, serial.SerialException):
+        return None
+
+
+def serial_ports():
+    if sys.platform.startswith('win'):
+        candidates = [f'COM{i}' for i in range(1, 256)]
+        with ThreadPoolExecutor(max_workers=32) as pool:
+            return [p for p in pool.map(_probe, candidates) if p]
+    elif sys.platform.startswith(('linux', 'cygwin')):
+        return sorted(glob.glob('/dev/rfcomm*'))
+    elif sys.platform.startswith('darwin'):
+        return glob.glob('/dev/tty.*')
+    raise EnvironmentError('Plataforma não suportada para detecção de portas seriais.')
+
+
+def discover_ports_async(callback):
+    """Roda serial_ports() numa thread e entrega a lista para callback."""
+    def run():
+        try:
+            ports = serial_ports()
+        except EnvironmentError:
+            ports = []
+        callback(ports)
+    threading.Thread(target=run, name="port-discovery", daemon=True).start()
+
+
+class LinkHealth:
+    def __init__(self, window_s=1.0):
+        self._lock = threading.Lock()
+        self._window_s = window_s
+        self.reset()
+
+    def reset(self):
+        with self._lock:
+            self._window_start = time.monotonic()
+            self._window_bytes = 0
+            self.bytes_per_s = 0.0
+            self.total_bytes = 0
+            self.frames = 0
+            self.errors = 0
+            self.handler_errors = 0  # exceções no tratamento de pacotes
+            self.gaps = [0] * (len(GAP_BINS_MS) + 1)
+            self._last_frame = None
+
+    def on_data(self, nbytes, frames, errors, now=None):
+        now = time.monotonic() if now is None else now
+        with self._lock:
+            self.total_bytes += nbytes
+            self._window_bytes += nbytes
+            self.frames += frames
+            self.errors += errors
+            self._roll(now)
+            if frames:
+                if self._last_frame is not None:
+                    gap_ms = (now - self._last_frame) * 1000.0
+                    for i, limit in enumerate(GAP_BINS_MS):
+                        if gap_ms < limit:
+                            self.gaps[i] += 1
+                            break
+                    else:
+                        self.gaps[-1] += 1
+                self._last_frame = now
+
+    def on_handler_error(self):
+        with self._lock:
+            self.handler_errors += 1
+
+    def _roll(self, now):
+        elapsed = now - self._window_start
+        if elapsed >= self._window_s:
+            self.bytes_per_s = self._window_bytes / elapsed
+            self._window_bytes = 0
+            self._window_start = now
+
+    @property
+    def error_rate(self):
+        total = self.frames + self.errors
+        return self.errors / total if total else 0.0
+
+    def summary(self):
+        with self._lock:
+            self._roll(time.monotonic())
+            total = sum(self.gaps)
+            if total:
+                slow = sum(self.gaps[GAP_BINS_MS.index(100):]) / total
+            else:
+                slow = 0.0
+            text = (f"{self.bytes_per_s:5.0f} B/s  erros {self.error_rate * 100:4.1f}%  "
+                    f"gaps>100ms {slow * 100:4.1f}%")
+            if self.handler_errors:
+                text += f"  falhas no tratamento {self.handler_errors}"
+            return text
+
+
+class ConnectionManager:
+    """Lê a porta numa thread própria e reconecta automaticamente.
+
+    on_event(button, value) é chamado para cada pacote decodificado e
+    on_status(texto, conectado) a cada mudança de estado; os dois rodam na
+    thread de leitura.
+    """
+
+    def __init__(self, port, on_event, on_status=None, recorder=None):
+        self.port = port
+        self.health = LinkHealth()
+        self._on_event = on_event
+        self._on_status = on_status or (lambda text, connected: None)
+        self._recorder = recorder
+        self._stop = threading.Event()
+        self._thread = None
+        self._ser = None
+        self.connected = False
+
+    def start(self):
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._run, name="serial-reader", daemon=True)
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=2)
+
+    @property
+    def running(self):
+        """True enquanto a thread usa a porta, conectada ou reconectando."""
+        return self._thread is not None and self._thread.is_alive() and not self._stop.is_set()
+
+    def send_command(self, cmd, value=0):
+        """Envia um comando ao controle; devolve False se desconectado."""
+        ser = self._ser
+        if ser is None:
+            return False
+        try:
+            ser.write(encode_command(cmd, value))
+        except (OSError, serial.SerialException):
+            return False
+        return True
+
+    def _set_status(self, text, connected):
+        self.connected = connected
+        self._on_status(text, connected)
+
+    def _run(self):
+        backoff = RECONNECT_MIN_S
+        while not self._stop.is_set():
+            try:
+                ser = serial.Serial(self.port, BAUD_RATE, timeout=0.1)
+            except (OSError, serial.SerialException):
+                self._set_status(f"Reconectando em {self.port}...", False)
+                self._stop.wait(backoff)
+                backoff = min(backoff * 2, RECONNECT_MAX_S)
+                continue
+
+            backoff = RECONNECT_MIN_S
+            self._ser = ser
+            self._set_status(f"Conectado em {self.port}", True)
+            try:
+                self._read_loop(ser)
+            except (OSError, serial.SerialException):
+                self._set_status(f"Conexão perdida em {self.port}", False)
+            finally:
+                self._ser = None
+                ser.close()
+        self._set_status("Conexão encerrada.", False)
+
+    def _read_loop(self, ser):
+        decoder = FrameDecoder()
+        while not self._stop.is_set():
+            data = ser.read(ser.in_waiting or 1)
+            if not data:
+                continue
+            errors = decoder.errors
+            events = decoder.feed(data)
+            self.health.on_data(len(data), len(events), decoder.errors - errors)
+            if self._recorder:
+                self._recorder.write_raw(data)
+            for button, value in events:
+                if self._recorder:
+                    self._recorder.write_event(button, value)
+                try:
+                    self._on_event(button, value)
+                except Exception:
+                    # Um erro no tratamento de um pacote não derruba a leitura
+                    self.health.on_handler_error()
+                    print(f"{self.port}: erro tratando button={button} value={value}")
+                    traceback.print_exc()
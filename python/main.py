@@ -1,130 +1,106 @@
 import sys
-import glob
-import serial
-import pyautogui
 import tkinter as tk
 from tkinter import ttk, messagebox
-from time import sleep
-
-pyautogui.PAUSE = 0
-
-def move_mouse(button, value):
-    if button == 0:
-        pyautogui.moveRel(-value, 0)
-    elif button == 1:
-        pyautogui.moveRel(0, value)
-
-def handle_button(button, value):
-    if value == 1:
-        if button == 3:
-            pyautogui.keyDown('A')
-        elif button == 4:
-            pyautogui.keyDown('B')
-        elif button == 5:
-            pyautogui.keyDown('Z')
-        elif button == 6:
-            pyautogui.keyDown('X')
-    elif value == 0:
-        if button == 3:
-            pyautogui.keyUp('A')
-        elif button == 4:
-            pyautogui.keyUp('B')
-        elif button == 5:
-            pyautogui.keyUp('Z')
-        elif button == 6:
-            pyautogui.keyUp('X')
-
-def parse_data(data):
-    button = data[0]
-    value = int.from_bytes(data[1:3], byteorder='little', signed=True)
-    return button, value
-
-def controle(ser):
-    left_pressed = False
-    right_pressed = False
+
+from capture import CaptureWriter
+from controle import Controle
+from link import BAUD_RATE, ConnectionManager, discover_ports_async
+from protocol import (CMD_AHRS_SAVE, CMD_BUZZER, CMD_LED, CMD_SET_DEADZONE, CMD_SET_REPORT_RATE,
+                      CMD_SET_TILT_ENTER, CMD_SET_TILT_EXIT, CMD_STATS_DUMP, CODE_STAT_END,
+                      STAT_NAMES, FrameDecoder, is_ahrs, is_stat)
+
+# Parâmetros ajustáveis pela janela: nome -> comando
+AJUSTES = {
+    "Taxa joystick (Hz)": CMD_SET_REPORT_RATE,
+    "Deadzone": CMD_SET_DEADZONE,
+    "Tilt entra": CMD_SET_TILT_ENTER,
+    "Tilt sai": CMD_SET_TILT_EXIT,
+    "Bipe (ms)": CMD_BUZZER,
+    "LED (0/1)": CMD_LED,
+}
+
+def controle(ser, recorder=None):
+    decoder = FrameDecoder()
+    ctrl = Controle()
 
     while True:
-        sync = ser.read(size=1)
-        if not sync or sync[0] != 0xFF:
-            continue
-        data = ser.read(size=3)
-        if len(data) < 3:
+        data = ser.read(ser.in_waiting or 1)
+        if not data:
             continue
+        for button, value in decoder.feed(data):
+            if recorder:
+                recorder.write_event(button, value)
+            ctrl.handle_event(button, value)
 
-        button, value = parse_data(data)
-
-        if button in (0, 1):
-            move_mouse(button, value)
-
-        elif button == 8:  # Tilt esquerda
-            if value == 1 and not left_pressed:
-                pyautogui.keyDown('down')
-                pyautogui.keyUp('up')
-                left_pressed = True
-                right_pressed = False
-            elif value == 0 and left_pressed:
-                pyautogui.keyUp('down')
-                left_pressed = False
-
-        elif button == 9:  # Tilt direita
-            if value == 1 and not right_pressed:
-                pyautogui.keyDown('up')
-                pyautogui.keyUp('down')
-                right_pressed = True
-                left_pressed = False
-            elif value == 0 and right_pressed:
-                pyautogui.keyUp('up')
-                right_pressed = False
-
-        else:
-            handle_button(button, value)
-
-def serial_ports():
-    ports = []
-    if sys.platform.startswith('win'):
-        for i in range(1, 256):
-            port = f'COM{i}'
-            try:
-                s = serial.Serial(port)
-                s.close()
-                ports.append(port)
-            except (OSError, serial.SerialException):
-                pass
-    elif sys.platform.startswith(('linux', 'cygwin')):
-        # ports = glob.glob('/dev/tty[A-Za-z]*') 
-        ports = glob.glob('/dev/rfcomm0')
-    elif sys.platform.startswith('darwin'):
-        ports = glob.glob('/dev/tty.*')
-    else:
-        raise EnvironmentError('Plataforma não suportada para detecção de portas seriais.')
-    return ports
-
-def conectar_porta(port_name, root, botao_conectar, status_label, mudar_cor_circulo):
+def conectar_porta(port_name, ui, record_path=None):
     if not port_name:
         messagebox.showwarning("Aviso", "Selecione uma porta serial antes de conectar.")
         return
-    try:
-        ser = serial.Serial(port_name, 9600, timeout=1)
-        status_label.config(text=f"Conectado em {port_name}", foreground="green")
-        mudar_cor_circulo("green")
-        botao_conectar.config(text="Conectado")
-        root.update()
-        controle(ser)
-    except KeyboardInterrupt:
-        print("Encerrando via KeyboardInterrupt.")
-    except Exception as e:
-        messagebox.showerror("Erro de Conexão", f"Não foi possível conectar em {port_name}.\nErro: {e}")
-        mudar_cor_circulo("red")
-    finally:
-        if 'ser' in locals() and ser.is_open:
-            ser.close()
-        status_label.config(text="Conexão encerrada.", foreground="red")
-        mudar_cor_circulo("red")
-
-def criar_janela():
+    if ui.manager:
+        ui.manager.stop()
+    if ui.recorder:
+        ui.recorder.close()
+        ui.recorder = None
+    if record_path:
+        ui.recorder = CaptureWriter(record_path, baud=BAUD_RATE)
+        ui.recorder.write_mark(f"porta {port_name}")
+
+    ctrl = Controle()
+
+    def on_event(button, value):
+        if is_stat(button):
+            ui.on_stat(button, value)
+        elif is_ahrs(button):
+            ui.on_ahrs_saved(value)
+        else:
+            ctrl.handle_event(button, value)
+
+    ui.manager = ConnectionManager(port_name, on_event, ui.set_status, ui.recorder)
+    ui.manager.start()
+    ui.botao_conectar.config(text="Conectado")
+
+class EstadoJanela:
+    """Estado compartilhado entre a janela e a thread de leitura serial."""
+
+    def __init__(self):
+        self.manager = None
+        self.recorder = None
+        self.botao_conectar = None
+        self._status = None
+        self._stats = {}
+
+    def set_status(self, text, connected):
+        # Chamado pela thread de leitura; a janela lê no próximo poll
+        self._status = (text, connected)
+
+    def on_stat(self, code, value):
+        if code == CODE_STAT_END:
+            texto = "  ".join(f"{k}={v}" for k, v in self._stats.items())
+            print(f"stats: {texto}")
+            self._status = (f"Stats: {texto}", True)
+            self._stats = {}
+        else:
+            self._stats[STAT_NAMES[code]] = value & 0xFFFF
+
+    def on_ahrs_saved(self, value):
+        # Resposta ao "Salvar orientação" (CMD_AHRS_SAVE)
+        texto = "Orientação salva" if value == 1 else "Falha ao salvar a orientação na flash"
+        print(texto)
+        self._status = (texto, True)
+
+    def send_command(self, cmd, value=0):
+        if not (self.manager and self.manager.send_command(cmd, value)):
+            messagebox.showwarning("Aviso", "Controle desconectado.")
+
+    def take_status(self):
+        status, self._status = self._status, None
+        return status
+
+def criar_janela(record_path=None):
+    ui = EstadoJanela()
     root = tk.Tk()
     root.title("Controle de Mouse")
-    root.geometry("400x250")
+    root.geometry("400x300")
     root.resizable(False, False)
 
     dark_bg = "#2e2e2e"
@@ -153,9 +129,29 @@ def criar_janela():
         frame_principal,
         text="Conectar e Iniciar Leitura",
         style="Accent.TButton",
-        command=lambda: conectar_porta(porta_var.get(), root, botao_conectar, status_label, mudar_cor_circulo)
+        command=lambda: conectar_porta(porta_var.get(), ui, record_path)
     )
     botao_conectar.pack(pady=10)
+    ui.botao_conectar = botao_conectar
+
+    ajuste_frame = ttk.Frame(frame_principal)
+    ajuste_frame.pack()
+    ajuste_var = tk.StringVar(value=next(iter(AJUSTES)))
+    ttk.Combobox(ajuste_frame, textvariable=ajuste_var, values=list(AJUSTES), state="readonly", width=18).grid(row=0, column=0)
+    valor_var = tk.StringVar(value="")
+    ttk.Entry(ajuste_frame, textvariable=valor_var, width=7).grid(row=0, column=1, padx=5)
+
+    def enviar_ajuste():
+        try:
+            valor = int(valor_var.get())
+        except ValueError:
+            messagebox.showwarning("Aviso", "Valor deve ser um número inteiro.")
+            return
+        ui.send_command(AJUSTES[ajuste_var.get()], valor)
+
+    ttk.Button(ajuste_frame, text="Enviar", command=enviar_ajuste).grid(row=0, column=2)
+    ttk.Button(ajuste_frame, text="Stats", command=lambda: ui.send_command(CMD_STATS_DUMP)).grid(row=0, column=3, padx=(5, 0))
+    ttk.Button(ajuste_frame, text="Salvar orientação", command=lambda: ui.send_command(CMD_AHRS_SAVE)).grid(row=0, column=4, padx=(5, 0))
 
     footer_frame = tk.Frame(root, bg=dark_bg)
     footer_frame.pack(side="bottom", fill="x", padx=10, pady=(10, 0))
@@ -163,22 +159,59 @@ def criar_janela():
     status_label = tk.Label(footer_frame, text="Aguardando seleção de porta...", font=("Segoe UI", 11), bg=dark_bg, fg=dark_fg)
     status_label.grid(row=0, column=0, sticky="w")
 
-    portas_disponiveis = serial_ports()
-    if portas_disponiveis:
-        porta_var.set(portas_disponiveis[0])
-    port_dropdown = ttk.Combobox(footer_frame, textvariable=porta_var, values=portas_disponiveis, state="readonly", width=10)
+    port_dropdown = ttk.Combobox(footer_frame, textvariable=porta_var, values=[], state="readonly", width=10)
     port_dropdown.grid(row=0, column=1, padx=10)
 
     circle_canvas = tk.Canvas(footer_frame, width=20, height=20, highlightthickness=0, bg=dark_bg)
     circle_item = circle_canvas.create_oval(2, 2, 18, 18, fill="red", outline="")
     circle_canvas.grid(row=0, column=2, sticky="e")
 
+    health_label = tk.Label(footer_frame, text="", font=("Segoe UI", 9), bg=dark_bg, fg="#aaaaaa")
+    health_label.grid(row=1, column=0, columnspan=3, sticky="w")
+
     footer_frame.columnconfigure(1, weight=1)
 
     def mudar_cor_circulo(cor):
         circle_canvas.itemconfig(circle_item, fill=cor)
 
+    def portas_encontradas(portas):
+        def aplicar():
+            port_dropdown.config(values=portas)
+            if portas and not porta_var.get():
+                porta_var.set(portas[0])
+        root.after(0, aplicar)
+
+    def atualizar_portas():
+        # Sondar a porta que está reconectando a abriria no Windows
+        if not (ui.manager and ui.manager.running):
+            discover_ports_async(portas_encontradas)
+        root.after(5000, atualizar_portas)
+
+    def atualizar_status():
+        status = ui.take_status()
+        if status:
+            text, connected = status
+            status_label.config(text=text, fg="green" if connected else "red")
+            mudar_cor_circulo("green" if connected else "red")
+        if ui.manager:
+            health_label.config(text=ui.manager.health.summary())
+        root.after(250, atualizar_status)
+
+    def fechar():
+        if ui.manager:
+            ui.manager.stop()
+        if ui.recorder:
+            ui.recorder.close()
+        root.destroy()
+
+    root.protocol("WM_DELETE_WINDOW", fechar)
+    atualizar_portas()
+    atualizar_status()
     root.mainloop()
 
 if __name__ == "__main__":
-    criar_janela()
\ No newline at end of file
+    # python main.py [--record sessao.lbcap]
+    record_path = None
+    if len(sys.argv) > 2 and sys.argv[1] == "--record":
+        record_path = sys.argv[2]
+    criar_janela(record_path)
\ No newline at end of file
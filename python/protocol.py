@@ -0,0 +1,167 @@
+"""Protocolo do link serial entre controle e host (ver main/protocol.h).
+
+Cada pacote tem 4 bytes: [code, value_lsb, value_msb, 0xFF], com value
+em int16 little-endian, nos dois sentidos.
+"""
+
+import struct
+
+FRAME_SIZE = 4
+FRAME_END = 0xFF
+
+# Respostas a CMD_STATS_DUMP (controle -> host)
+STAT_NAMES = {
+    0x20: 'uptime_s',
+    0x21: 'events_sent',
+    0x22: 'queue_drops',
+    0x23: 'rx_frames',
+    0x24: 'rx_errors',
+    0x25: 'rx_overflows',
+    0x26: 'display_fps',
+    0x27: 'display_flush_us',
+    0x28: 'display_drops',
+    0x29: 'display_over_budget',
+}
+CODE_STAT_END = 0x2F
+
+# Resposta a CMD_CAL_CAPTURE (controle -> host): médias em contagens cruas
+CAL_NAMES = {
+    0x30: 'accel_x',
+    0x31: 'accel_y',
+    0x32: 'accel_z',
+    0x33: 'gyro_x',
+    0x34: 'gyro_y',
+    0x35: 'gyro_z',
+    0x36: 'angle_x',  # giroscópio integrado, graus nominais * CAL_ANGLE_SCALE
+    0x37: 'angle_y',
+    0x38: 'angle_z',
+    0x39: 'spread',   # maior (máx - mín) de um eixo do acelerômetro
+    0x3B: 'gyro_scale',   # contagens por °/s * 10 na faixa configurada
+    0x3C: 'accel_scale',  # contagens por g na faixa configurada
+}
+CODE_CAL_SAVED = 0x3A
+CODE_CAL_END = 0x3F
+CAL_ANGLE_SCALE = 32
+
+# Resposta a CMD_AHRS_SAVE: 1 gravado, 0 erro na flash
+CODE_AHRS_SAVED = 0x40
+
+# Resposta a CMD_IMU_RECORD: as amostras que o AHRS recebeu, seis pacotes por
+# amostra (°/s * IMU_RECORD_GYRO_ONE, g * IMU_RECORD_ACCEL_ONE), e no fim
+# CODE_IMU_END com o número de amostras
+IMU_CODES = (0x50, 0x51, 0x52, 0x53, 0x54, 0x55)  # gx, gy, gz, ax, ay, az
+CODE_IMU_END = 0x5F
+IMU_RECORD_GYRO_ONE = 16
+IMU_RECORD_ACCEL_ONE = 4096
+
+# Comandos (host -> controle)
+CMD_SET_REPORT_RATE = 0x01
+CMD_SET_DEADZONE = 0x02
+CMD_SET_TILT_ENTER = 0x03
+CMD_SET_TILT_EXIT = 0x04
+CMD_BUZZER = 0x05
+CMD_LED = 0x06
+CMD_STATS_DUMP = 0x07
+CMD_CAL_CAPTURE = 0x08
+CMD_CAL_INDEX = 0x09
+CMD_CAL_VALUE = 0x0A
+CMD_CAL_COMMIT = 0x0B
+CMD_AHRS_SAVE = 0x0C  # guarda a orientação para a próxima vez que ligar
+CMD_IMU_RECORD = 0x0D  # grava value amostras da IMU e manda em seguida
+
+
+def encode_command(cmd, value=0):
+    return struct.pack('<BhB', cmd, value, FRAME_END)
+
+
+def is_stat(code):
+    return code in STAT_NAMES or code == CODE_STAT_END
+
+
+def is_cal(code):
+    return code in CAL_NAMES or code in (CODE_CAL_SAVED, CODE_CAL_END)
+
+
+def is_ahrs(code):
+    return code == CODE_AHRS_SAVED
+
+
+def is_imu(code):
+    return code in IMU_CODES or code == CODE_IMU_END
+
+
+def parse_data(data):
+    button = data[0]
+    value = int.from_bytes(data[1:3], byteorder='little', signed=True)
+    return button, value
+
+
+def _scan_py(buf, resync):
+    """Decodifica os pacotes completos de buf.
+
+    Devolve (events, consumed, errors, dropped, resync); mesma interface de
+    _framedecode.scan.
+    """
+    events = []
+    errors = dropped = 0
+    i = 0
+    n = len(buf)
+    while i + FRAME_SIZE <= n:
+        if buf[i + 3] == FRAME_END:
+            value = buf[i + 1] | (buf[i + 2] << 8)
+            if value >= 0x8000:
+                value -= 0x10000
+            events.append((buf[i], value))
+            i += FRAME_SIZE
+            resync = False
+        else:
+            if not resync:
+                errors += 1
+                resync = True
+            dropped += 1
+            i += 1
+    return events, i, errors, dropped, resync
+
+
+try:
+    from _framedecode import scan as _scan
+    NATIVE_DECODER = True
+except ImportError:
+    _scan = _scan_py
+    NATIVE_DECODER = False
+
+
+class FrameDecoder:
+    """Decodifica pacotes a partir de blocos de bytes de tamanho qualquer.
+
+    Bytes que não formam um pacote válido são descartados até o próximo
+    terminador; cada descarte conta como um erro de framing. Usa o módulo
+    nativo _framedecode quando ele foi compilado (python setup.py
+    build_ext --inplace).
+    """
+
+    def __init__(self, native=True):
+        self._scan = _scan if native else _scan_py
+        self._pending = b''
+        self._resync = False
+        self.frames = 0
+        self.errors = 0
+        self.dropped_bytes = 0
+
+    def feed(self, data):
+        buf = self._pending + bytes(data)
+        events, consumed, errors, dropped, self._resync = self._scan(buf, self._resync)
+        self._pending = buf[consumed:]
+        self.frames += len(events)
+        self.errors += errors
+        self.dropped_bytes += dropped
+        return events
+
+    @property
+    def pending(self):
+        """Bytes recebidos que ainda não formam um pacote."""
+        return self._pending
+
+    def reset(self):
+        self._pending = b''
+        self._resync = False
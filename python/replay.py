@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""Reproduz uma sessão gravada com `python main.py --record arquivo.lbcap`.
+
+    python replay.py sessao.lbcap              # tempo real, aciona teclado/mouse
+    python replay.py sessao.lbcap --max-speed  # sem esperas entre os pacotes
+    python replay.py sessao.lbcap --events     # só lista os eventos gravados
+"""
+
+import argparse
+
+from capture import CaptureReader, ReplaySerial
+
+
+def listar_eventos(reader):
+    for t_us, button, value in reader.events():
+        print(f"{t_us / 1e6:12.6f}  button={button:3d}  value={value:6d}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Reprodução de capturas do controle")
+    parser.add_argument("arquivo")
+    parser.add_argument("--max-speed", action="store_true", help="reproduz sem respeitar os tempos gravados")
+    parser.add_argument("--speed", type=float, default=1.0, help="fator de velocidade (1.0 = tempo real)")
+    parser.add_argument("--events", action="store_true", help="lista os eventos decodificados e sai")
+    args = parser.parse_args()
+
+    with CaptureReader(args.arquivo) as reader:
+        if args.events:
+            listar_eventos(reader)
+            return
+
+        # Importado só aqui para que --events funcione sem pyautogui/tk
+        from main import controle
+
+        ser = ReplaySerial(reader, speed=0 if args.max_speed else args.speed)
+        try:
+            controle(ser)
+        except EOFError:
+            print("Fim da captura.")
+
+
+if __name__ == "__main__":
+    main()
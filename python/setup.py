@@ -0,0 +1,31 @@
+# Módulo nativo opcional do decodificador de pacotes (ver protocol.py).
+#   python setup.py build_ext --inplace
+# Depois de compilar, o módulo passa pelos vetores de framedecode_vectors.json
+# (os mesmos de framedecode_check.py) e a compilação falha se algum diverge.
+import importlib.util
+
+from setuptools import Extension, setup
+from setuptools.command.build_ext import build_ext
+
+
+class build_ext_checked(build_ext):
+    def run(self):
+        super().run()
+        from framedecode_check import check_vectors, load_vectors
+
+        path = self.get_ext_fullpath("_framedecode")
+        spec = importlib.util.spec_from_file_location("_framedecode", path)
+        module = importlib.util.module_from_spec(spec)
+        spec.loader.exec_module(module)
+        failures = check_vectors(module.scan, load_vectors())
+        for message in failures:
+            print(f"_framedecode: {message}")
+        if failures:
+            raise SystemExit("_framedecode não passa nos vetores de teste")
+
+
+setup(
+    name="framedecode",
+    ext_modules=[Extension("_framedecode", sources=["_framedecode.c"])],
+    cmdclass={"build_ext": build_ext_checked},
+)